@@ -0,0 +1,44 @@
+/************************************************************************************************
+ * Actions:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Operations shared by the keys and the UART commands. Implemented in main.c. Must be called from
+// the main loop.
+
+typedef struct
+{
+    bool     on;
+    uint8_t  setpoint;      // degC
+    uint16_t time_left_min;
+    int8_t   temperature;
+    uint8_t  humidity;
+    int8_t   heater_temp;
+    bool     heater_on;
+    uint8_t  faults;        // FAULT_FLAG_* bits
+} SDryerStatus;
+
+void actionStart();
+void actionStop();
+
+// temp must be one of the menu values. False otherwise
+bool actionSetSetpoint(uint8_t temp);
+
+// hours must be one of the menu values. Restarts the session time. False otherwise
+bool actionSetTime(uint8_t hours);
+
+// Current setpoint and time are used after power up
+void actionSaveProfile();
+void actionGetProfile(uint8_t *temp, uint8_t *hours, bool *start_on);
+
+void actionToggleStartPower();
+void actionToggleBeeper();
+
+bool actionSetHeaterWatts(uint16_t watts);
+uint16_t actionGetHeaterWatts();
+
+void actionGetStatus(SDryerStatus *status);
@@ -3,6 +3,8 @@
  ************************************************************************************************/
 
 #include "aht20.h"
+#include <faults.h>
+#include <clock.h>
 
 #include <stm8s_i2c.h>
 
@@ -10,6 +12,36 @@
 #define TIMEOUT       0xFFFF
 #define AHT20_ADDRESS 0x38
 
+// Timing registers as I2C_Init() sets them for each clock mode. Fast mode needs fMASTER of
+// 4 MHz at least, so the idle clock runs the bus at 100 kHz.
+typedef struct
+{
+    uint8_t freqr;
+    uint8_t ccrl;
+    uint8_t ccrh;
+    uint8_t triser;
+} SI2CTiming;
+
+const SI2CTiming i2c_timings[CLOCK_MODES_COUNT] =
+{
+    {16, 13, 0x80, 5}, // 16 MHz, fast mode, 400 kHz, duty 2
+    {2,  10, 0x00, 3}, //  2 MHz, standard mode, 100 kHz
+};
+
+// private:
+void retuneI2C(EClockMode mode)
+{
+    const SI2CTiming *timing = &i2c_timings[mode];
+
+    // CCR and TRISE can be written only while the peripheral is disabled
+    I2C->CR1   &= (uint8_t)~I2C_CR1_PE;
+    I2C->FREQR  = timing->freqr;
+    I2C->CCRL   = timing->ccrl;
+    I2C->CCRH   = timing->ccrh;
+    I2C->TRISER = timing->triser;
+    I2C->CR1   |= I2C_CR1_PE;
+}
+
 // private:
 void initI2C()
 {
@@ -18,6 +50,9 @@ void initI2C()
     /* I2C configuration after enabling it */
     I2C_Cmd(ENABLE);
     I2C_Init(I2C_SPEED, 15, I2C_DUTYCYCLE_2, I2C_ACK_CURR, I2C_ADDMODE_7BIT, 16);
+    retuneI2C(getClockMode());
+
+    addClockHandler(retuneI2C);
 }
 
 // private:
@@ -73,7 +108,7 @@ bool initAHT20(GPIO_TypeDef* port_name_sck, GPIO_Pin_TypeDef port_pin_sck, GPIO_
     /* Test on EV5 and clear it */
     if (!waitEvent(I2C_EVENT_MASTER_MODE_SELECT))
     {
-        fatal(0);
+        raiseFault(FAULT_AHT20_INIT_START);
         return false;
     }
 
@@ -83,13 +118,13 @@ bool initAHT20(GPIO_TypeDef* port_name_sck, GPIO_Pin_TypeDef port_pin_sck, GPIO_
     /* Test on EV6 and clear it */
     if (!waitEvent(I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
     {
-        fatal(1);
+        raiseFault(FAULT_AHT20_INIT_ADDRESS);
         return false;
     }
 
     if (!sendByte(0xBE))
     {
-        fatal(2);
+        raiseFault(FAULT_AHT20_INIT_COMMAND);
         return false;
     }
 
@@ -104,6 +139,7 @@ bool initAHT20(GPIO_TypeDef* port_name_sck, GPIO_Pin_TypeDef port_pin_sck, GPIO_
 }
 
 // private:
+// Steps of a read don't raise faults, the caller raises one per failed read
 bool readFromAHT20(uint8_t *buffer, uint8_t bytes)
 {
     /* While the bus is busy */
@@ -112,7 +148,6 @@ bool readFromAHT20(uint8_t *buffer, uint8_t bytes)
     {
         if ((timeout--) == 0)
         {
-            fatal(11);
             return false;
         };
     }
@@ -123,7 +158,6 @@ bool readFromAHT20(uint8_t *buffer, uint8_t bytes)
     /* Test on EV5 and clear it */
     if (!waitEvent(I2C_EVENT_MASTER_MODE_SELECT))
     {
-        fatal(12);
         return false;
     }
 
@@ -132,7 +166,6 @@ bool readFromAHT20(uint8_t *buffer, uint8_t bytes)
 
     if (!waitEvent(I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED))
     {
-        fatal(13);
         return false;
     }
 
@@ -152,7 +185,6 @@ bool readFromAHT20(uint8_t *buffer, uint8_t bytes)
         /* Test on EV6 and clear it */
         if (!waitEvent(I2C_EVENT_MASTER_BYTE_RECEIVED))
         {
-            fatal(14);
             return false;
         }
 
@@ -178,7 +210,6 @@ bool startAHT20()
     /* Test on EV5 and clear it */
     if (!waitEvent(I2C_EVENT_MASTER_MODE_SELECT))
     {
-        fatal(20);
         return false;
     }
 
@@ -188,14 +219,12 @@ bool startAHT20()
     /* Test on EV6 and clear it */
     if (!waitEvent(I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
     {
-        fatal(21);
         return false;
     }
 
     uint8_t data[] = {0xAC, 0x33, 0x00};
     if (!sendBuffer(data, sizeof(data)))
     {
-        fatal(22);
         return false;
     }
 
@@ -207,7 +236,6 @@ bool startAHT20()
         uint8_t data;
         if (!readFromAHT20(&data, 1))
         {
-            fatal(23);
             return false;
         }
 
@@ -230,14 +258,14 @@ bool readAHT20(int8_t *t, uint8_t *h)
 {
     if (!startAHT20())
     {
-        fatal(30);
+        raiseFault(FAULT_AHT20_TRIGGER);
         return false;
     }
 
     uint8_t data[6];
     if (!readFromAHT20(data, 6))
     {
-        fatal(31);
+        raiseFault(FAULT_AHT20_RESULT);
         return false;
     }
 
@@ -264,3 +292,8 @@ bool readAHT20(int8_t *t, uint8_t *h)
     return true;
 }
 
+// public:
+bool readAHT20Status(uint8_t *status)
+{
+    return readFromAHT20(status, 1);
+}
@@ -14,3 +14,9 @@ bool initAHT20(GPIO_TypeDef* port_name_sck, GPIO_Pin_TypeDef port_pin_sck, GPIO_
 
 // Reads temp in humidity from sensor. Blocking
 bool readAHT20(int8_t *t, uint8_t *h);
+
+#define AHT20_STATUS_BUSY       0x80
+#define AHT20_STATUS_CALIBRATED 0x08
+
+// Reads the status byte, false if the sensor does not answer at its address
+bool readAHT20Status(uint8_t *status);
@@ -0,0 +1,79 @@
+/************************************************************************************************
+ * Clock:
+ ************************************************************************************************/
+
+#include <clock.h>
+#include <utilities.h>
+
+#include <stm8s_clk.h>
+
+#define CLOCK_HSI_HZ 16000000ul
+
+const uint8_t clock_hsi_dividers[] = {CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_HSIDIV8};
+const uint8_t clock_hsi_shifts[]   = {0, 3};
+
+EClockMode   clock_mode = CLOCK_ACTIVE;
+ClockHandler clock_handlers[CLOCK_HANDLERS_MAX];
+uint8_t      clock_handlers_count = 0;
+
+// public:
+void initClock()
+{
+    CLK_HSICmd(ENABLE);
+    CLK_HSIPrescalerConfig(CLK_PRESCALER_HSIDIV1);
+    CLK_SYSCLKConfig(CLK_PRESCALER_CPUDIV1);
+
+    clock_mode = CLOCK_ACTIVE;
+}
+
+// public:
+void setClockMode(EClockMode mode)
+{
+    if (mode == clock_mode)
+    {
+        return;
+    }
+
+    CRITICAL
+    {
+        CLK_HSIPrescalerConfig((CLK_Prescaler_TypeDef)clock_hsi_dividers[mode]);
+        clock_mode = mode;
+
+        for (uint8_t i = 0; i < clock_handlers_count; i++)
+        {
+            clock_handlers[i](mode);
+        }
+    }
+}
+
+// public:
+EClockMode getClockMode()
+{
+    return clock_mode;
+}
+
+// public:
+uint32_t getClockFrequency(EClockMode mode)
+{
+    return CLOCK_HSI_HZ >> clock_hsi_shifts[mode];
+}
+
+// public:
+bool addClockHandler(ClockHandler handler)
+{
+    for (uint8_t i = 0; i < clock_handlers_count; i++)
+    {
+        if (handler == clock_handlers[i])
+        {
+            return true;
+        }
+    }
+
+    if (CLOCK_HANDLERS_MAX == clock_handlers_count)
+    {
+        return false;
+    }
+
+    clock_handlers[clock_handlers_count++] = handler;
+    return true;
+}
@@ -0,0 +1,41 @@
+/************************************************************************************************
+ * Clock:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// fMASTER operating points, both from HSI. LSI is not used: 128 kHz can't give the 1 us timer
+// tick nor the UART baud rates.
+typedef enum
+{
+    CLOCK_ACTIVE, // HSI / 1, 16 MHz
+    CLOCK_IDLE,   // HSI / 8,  2 MHz
+    CLOCK_MODES_COUNT
+} EClockMode;
+
+#ifndef CLOCK_HANDLERS_MAX
+#define CLOCK_HANDLERS_MAX 4
+#endif
+
+// Called with interrupts disabled right after fMASTER has changed, reloads a peripheral with
+// values precomputed for the mode. At 2 MHz every cycle counts against the 1 ms tick, so it
+// must be register writes only: no divisions, no SPL init functions.
+typedef void (*ClockHandler)(EClockMode mode);
+
+// HSI on, CPU undivided, starts at CLOCK_ACTIVE
+void initClock();
+
+// Switches the operating point and calls the handlers. Does nothing if it is already set
+void setClockMode(EClockMode mode);
+
+EClockMode getClockMode();
+
+// fMASTER of the mode, Hz
+uint32_t getClockFrequency(EClockMode mode);
+
+// Handlers are called in the order they were added, adding one twice is ignored. False if
+// there is no room
+bool addClockHandler(ClockHandler handler);
@@ -0,0 +1,369 @@
+/************************************************************************************************
+ * Commands:
+ ************************************************************************************************/
+
+#include <commands.h>
+#include <protocol.h>
+#include <actions.h>
+#include <telemetry.h>
+#include <stats.h>
+#include <history.h>
+#include <watchdog.h>
+#include <faults.h>
+#include <uart.h>
+#include <crc16.h>
+#include <utilities.h>
+
+typedef enum
+{
+    PARSER_SOF,
+    PARSER_TYPE,
+    PARSER_LENGTH,
+    PARSER_PAYLOAD,
+    PARSER_CRC_LOW,
+    PARSER_CRC_HIGH,
+} EParserState;
+
+// Returns ECommandStatus, response data goes after the status byte
+typedef uint8_t (*CommandHandler)(const uint8_t *request, uint8_t *response, uint8_t *size);
+
+typedef struct
+{
+    uint8_t        type;
+    uint8_t        request_size;
+    CommandHandler handler;
+} SCommand;
+
+EParserState     parser_state = PARSER_SOF;
+uint8_t          parser_pos   = 0;
+uint16_t         parser_crc   = 0;
+uint8_t          command_type = 0;
+uint8_t          command_size = 0;
+uint8_t          command_payload[PROTOCOL_PAYLOAD_MAX];
+volatile bool    command_ready = false; // set by the RX interrupt, cleared by the main loop
+volatile bool    parser_idle   = true;  // no byte since the last handleCommands()
+
+// private:
+void putU16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+// private:
+void putU32(uint8_t *buffer, uint32_t value)
+{
+    putU16(&buffer[0], (uint16_t)value);
+    putU16(&buffer[2], (uint16_t)(value >> 16));
+}
+
+// private:
+uint8_t getStatusCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    SDryerStatus status;
+
+    (void)request;
+    actionGetStatus(&status);
+
+    response[0] = status.on;
+    response[1] = status.setpoint;
+    putU16(&response[2], status.time_left_min);
+    response[4] = (uint8_t)status.temperature;
+    response[5] = status.humidity;
+    response[6] = (uint8_t)status.heater_temp;
+    response[7] = status.heater_on;
+    response[8] = status.faults;
+    *size = 9;
+
+    return STATUS_OK;
+}
+
+// private:
+uint8_t setSetpointCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)response; (void)size;
+    return actionSetSetpoint(request[0]) ? STATUS_OK : STATUS_BAD_VALUE;
+}
+
+// private:
+uint8_t setTimeCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)response; (void)size;
+    return actionSetTime(request[0]) ? STATUS_OK : STATUS_BAD_VALUE;
+}
+
+// private:
+uint8_t startCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)request; (void)response; (void)size;
+    actionStart();
+    return STATUS_OK;
+}
+
+// private:
+uint8_t stopCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)request; (void)response; (void)size;
+    actionStop();
+    return STATUS_OK;
+}
+
+// private:
+uint8_t getProfileCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    bool start_on;
+
+    (void)request;
+    actionGetProfile(&response[0], &response[1], &start_on);
+    response[2] = start_on;
+    *size = 3;
+
+    return STATUS_OK;
+}
+
+// private:
+uint8_t saveProfileCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)request; (void)response; (void)size;
+    actionSaveProfile();
+    return STATUS_OK;
+}
+
+// private:
+uint8_t getStatsCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    const SStats *stats = getStats();
+
+    (void)request;
+    putU32(&response[0],  stats->heater_on_s);
+    putU32(&response[4],  stats->energy_wh);
+    putU16(&response[8],  stats->sessions);
+    putU32(&response[10], stats->heater_cycles);
+
+    for (uint8_t i = 0; i < STATS_FAULT_COUNTERS; i++)
+    {
+        response[14 + i] = stats->faults[i];
+    }
+    *size = 14 + STATS_FAULT_COUNTERS;
+
+    return STATUS_OK;
+}
+
+// private:
+uint8_t getFaultsCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    const SStats *stats = getStats();
+    SDryerStatus  status;
+
+    (void)request;
+    actionGetStatus(&status);
+
+    response[0] = status.faults;
+
+    for (uint8_t i = 0; i < STATS_FAULT_COUNTERS; i++)
+    {
+        response[1 + i] = stats->faults[i];
+    }
+
+    response[1 + STATS_FAULT_COUNTERS] = getResetCause();
+    putU16(&response[2 + STATS_FAULT_COUNTERS], getResetCount(RESET_WATCHDOG));
+    response[4 + STATS_FAULT_COUNTERS] = getLatchedFault();
+    *size = 5 + STATS_FAULT_COUNTERS;
+
+    SFaultLogEntry entry;
+
+    for (uint8_t i = 0; getFaultLogEntry(i, &entry); i++)
+    {
+        response[*size] = entry.code;
+        putU16(&response[*size + 1], entry.uptime_min);
+        *size += 3;
+    }
+
+    return STATUS_OK;
+}
+
+// private:
+uint8_t setTelemetryCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)response; (void)size;
+
+    if (TELEMETRY_PERIOD_MAX < request[0])
+    {
+        return STATUS_BAD_VALUE;
+    }
+
+    setTelemetryPeriod(request[0]);
+    return STATUS_OK;
+}
+
+// private:
+uint8_t setHeaterWattsCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    (void)response; (void)size;
+    return actionSetHeaterWatts(request[0] | ((uint16_t)request[1] << 8)) ? STATUS_OK : STATUS_BAD_VALUE;
+}
+
+// private:
+uint8_t getHistoryCommand(const uint8_t *request, uint8_t *response, uint8_t *size)
+{
+    uint8_t tier  = request[0];
+    uint8_t first = request[1];
+
+    if (HISTORY_TIERS_COUNT <= tier)
+    {
+        return STATUS_BAD_VALUE;
+    }
+
+    uint8_t count = getHistoryCount(tier);
+
+    response[0] = count;
+    response[1] = first;
+    *size = 2;
+
+    if (!getHistorySample(tier, first, (int8_t*)&response[2]))
+    {
+        return STATUS_OK;
+    }
+    *size += HISTORY_CHANNELS;
+
+    const uint8_t max_size = 2 + HISTORY_CHANNELS + 2 * HISTORY_FRAME_DELTAS;
+
+    for (uint8_t i = first + 1; (i < count) && (*size < max_size); i++)
+    {
+        putU16(&response[*size], getHistoryDelta(tier, i));
+        *size += 2;
+    }
+
+    return STATUS_OK;
+}
+
+const SCommand commands[] =
+{
+    {CMD_GET_STATUS,       0, getStatusCommand},
+    {CMD_SET_SETPOINT,     1, setSetpointCommand},
+    {CMD_SET_TIME,         1, setTimeCommand},
+    {CMD_START,            0, startCommand},
+    {CMD_STOP,             0, stopCommand},
+    {CMD_GET_PROFILE,      0, getProfileCommand},
+    {CMD_SAVE_PROFILE,     0, saveProfileCommand},
+    {CMD_GET_STATS,        0, getStatsCommand},
+    {CMD_GET_FAULTS,       0, getFaultsCommand},
+    {CMD_SET_TELEMETRY,    1, setTelemetryCommand},
+    {CMD_SET_HEATER_WATTS, 2, setHeaterWattsCommand},
+    {CMD_GET_HISTORY,      2, getHistoryCommand},
+};
+
+// private:
+// Called from the RX interrupt
+void receiveCommandByte(uint8_t data)
+{
+    if (command_ready)
+    {
+        return;
+    }
+
+    parser_idle = false;
+
+    switch (parser_state)
+    {
+        case PARSER_SOF:
+            if (PROTOCOL_SOF == data)
+            {
+                parser_state = PARSER_TYPE;
+            }
+            break;
+
+        case PARSER_TYPE:
+            command_type = data;
+            parser_crc   = updateCRC16(CRC16_INIT, data);
+            parser_state = PARSER_LENGTH;
+            break;
+
+        case PARSER_LENGTH:
+            command_size = data;
+            parser_pos   = 0;
+            parser_crc   = updateCRC16(parser_crc, data);
+
+            if (PROTOCOL_PAYLOAD_MAX < data)
+            {
+                parser_state = PARSER_SOF;
+            }
+            else
+            {
+                parser_state = (0 == data) ? PARSER_CRC_LOW : PARSER_PAYLOAD;
+            }
+            break;
+
+        case PARSER_PAYLOAD:
+            command_payload[parser_pos++] = data;
+            parser_crc = updateCRC16(parser_crc, data);
+
+            if (command_size == parser_pos)
+            {
+                parser_state = PARSER_CRC_LOW;
+            }
+            break;
+
+        case PARSER_CRC_LOW:
+            parser_state = ((uint8_t)parser_crc == data) ? PARSER_CRC_HIGH : PARSER_SOF;
+            break;
+
+        default:
+            if ((uint8_t)(parser_crc >> 8) == data)
+            {
+                command_ready = true;
+            }
+            parser_state = PARSER_SOF;
+            break;
+    }
+}
+
+// public:
+void initCommands()
+{
+    setUARTReceiver(receiveCommandByte);
+}
+
+// public:
+void handleCommands()
+{
+    uint8_t response[1 + PROTOCOL_PAYLOAD_MAX];
+    uint8_t size   = 0;
+    uint8_t status = STATUS_UNKNOWN_COMMAND;
+
+    if (!command_ready)
+    {
+        // a gap inside of a frame means it was truncated or SOF was a data byte
+        CRITICAL
+        {
+            if (parser_idle)
+            {
+                parser_state = PARSER_SOF;
+            }
+            parser_idle = true;
+        }
+        return;
+    }
+
+    // the response must fit entirely, otherwise the command waits for the next loop
+    if (getUARTFreeSpace() < (1 + PROTOCOL_PAYLOAD_MAX + PROTOCOL_OVERHEAD))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < (sizeof(commands) / sizeof(SCommand)); i++)
+    {
+        if (command_type == commands[i].type)
+        {
+            status = (commands[i].request_size == command_size) ?
+                     commands[i].handler(command_payload, &response[1], &size) :
+                     STATUS_BAD_LENGTH;
+            break;
+        }
+    }
+
+    response[0] = status;
+    sendFrame(command_type | FRAME_RESPONSE, response, 1 + size);
+
+    command_ready = false;
+}
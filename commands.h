@@ -0,0 +1,20 @@
+/************************************************************************************************
+ * Commands:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Request/response protocol over UART, see protocol.h. Frames are parsed byte by byte in the RX
+// interrupt into a single buffer; the command itself runs in the main loop through actions.h.
+// Bytes received while a command waits for execution are dropped, the host must wait for the
+// response before the next request. A frame is dropped if its bytes pause for a main loop
+// iteration, so the parser resynchronizes after noise.
+
+// Registers the parser as UART receiver
+void initCommands();
+
+// Executes a received command and sends the response. Must be called from the main loop
+void handleCommands();
@@ -0,0 +1,38 @@
+/************************************************************************************************
+ * CRC-16:
+ ************************************************************************************************/
+
+#include <crc16.h>
+
+// public:
+uint16_t updateCRC16(uint16_t crc, uint8_t data)
+{
+    crc ^= data;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (crc & 1)
+        {
+            crc = (crc >> 1) ^ 0xA001;
+        }
+        else
+        {
+            crc >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+// public:
+uint16_t calcCRC16(const uint8_t *data, uint8_t size)
+{
+    uint16_t crc = CRC16_INIT;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        crc = updateCRC16(crc, data[i]);
+    }
+
+    return crc;
+}
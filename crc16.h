@@ -0,0 +1,14 @@
+/************************************************************************************************
+ * CRC-16:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF). Bitwise, no table to save flash
+#define CRC16_INIT 0xFFFF
+
+uint16_t updateCRC16(uint16_t crc, uint8_t data);
+
+uint16_t calcCRC16(const uint8_t *data, uint8_t size);
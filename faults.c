@@ -0,0 +1,229 @@
+/************************************************************************************************
+ * Faults:
+ ************************************************************************************************/
+
+#include <faults.h>
+#include <protocol.h>
+#include <journal.h>
+#include <outputs.h>
+#include <stats.h>
+#include <utilities.h>
+
+#include <string.h>
+
+#define FAULTS_VERSION    1
+#define FAULT_ENTRY_SIZE  3 // code, uptime_min, serialized by hand to stay packed
+
+const uint8_t  fault_codes[FAULT_CODES_COUNT] =
+{
+    FAULT_AHT20_INIT_START,  FAULT_AHT20_INIT_ADDRESS, FAULT_AHT20_INIT_COMMAND,
+    FAULT_AHT20_TRIGGER,     FAULT_AHT20_RESULT,
+    FAULT_SENSOR_LOST,       FAULT_POST_SENSOR,
+    FAULT_NTC_RANGE,         FAULT_POST_NTC_OPEN,      FAULT_POST_NTC_SHORT,
+    FAULT_HEATER_NO_RISE,    FAULT_HEATER_OFF_RISE,    FAULT_SENSOR_MISMATCH,
+    FAULT_READINGS_STALE,    FAULT_POST_HEATER,
+    FAULT_OUTPUT_READBACK,
+    FAULT_WATCHDOG_RESET,    FAULT_POST_EEPROM,
+};
+
+uint8_t        fault_flags        = 0;
+SFaultLogEntry fault_log[FAULT_LOG_SIZE];
+// bit N - the code with index N has been logged in the window
+uint8_t        fault_holdoff[(FAULT_CODES_COUNT + 7) / 8];
+uint16_t       fault_holdoff_window = 0; // uptime_min / FAULT_LOG_HOLDOFF_MIN
+EFault         fault_latched      = FAULT_NONE;
+EFault         fault_shown        = FAULT_NONE;
+uint32_t       fault_shown_ms     = 0;
+
+// private:
+void storeFaultLog()
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE] = {0};
+
+    for (uint8_t i = 0; i < FAULT_LOG_SIZE; i++)
+    {
+        payload[i * FAULT_ENTRY_SIZE]     = fault_log[i].code;
+        payload[i * FAULT_ENTRY_SIZE + 1] = (uint8_t)fault_log[i].uptime_min;
+        payload[i * FAULT_ENTRY_SIZE + 2] = fault_log[i].uptime_min >> 8;
+    }
+
+    writeJournal(JOURNAL_FAULTS, FAULTS_VERSION, payload, 0);
+}
+
+// private:
+// False if the same code has been logged in the current holdoff window. The windows don't depend
+// on the log, so codes which push each other out of it are held off as well
+bool logFault(EFault fault, uint16_t uptime_min)
+{
+    uint8_t index = getFaultIndex(fault);
+    uint8_t byte  = index / 8;
+    uint8_t bit   = 1 << (index % 8);
+
+    if (FAULT_CODES_COUNT <= index)
+    {
+        return false;
+    }
+
+    if ((uptime_min / FAULT_LOG_HOLDOFF_MIN) != fault_holdoff_window)
+    {
+        fault_holdoff_window = uptime_min / FAULT_LOG_HOLDOFF_MIN;
+        memset(fault_holdoff, 0, sizeof(fault_holdoff));
+    }
+
+    if (fault_holdoff[byte] & bit)
+    {
+        return false;
+    }
+
+    fault_holdoff[byte] |= bit;
+
+    for (uint8_t i = FAULT_LOG_SIZE - 1; i > 0; i--)
+    {
+        fault_log[i] = fault_log[i - 1];
+    }
+
+    fault_log[0].code       = fault;
+    fault_log[0].uptime_min = uptime_min;
+
+    storeFaultLog();
+
+    return true;
+}
+
+// private:
+uint8_t getFaultFlag(EFault fault)
+{
+    switch (fault / 10)
+    {
+        case 5:  return FAULT_FLAG_NTC;
+        case 6:  return FAULT_FLAG_SAFETY;
+        case 7:  return FAULT_FLAG_OUTPUT;
+        case 8:  return 0;
+        default: return FAULT_FLAG_SENSOR;
+    }
+}
+
+// public:
+void initFaults()
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    uint8_t version;
+
+    fault_holdoff_window = 0;
+    memset(fault_holdoff, 0, sizeof(fault_holdoff));
+
+    for (uint8_t i = 0; i < FAULT_LOG_SIZE; i++)
+    {
+        fault_log[i].code       = FAULT_NONE;
+        fault_log[i].uptime_min = 0;
+    }
+
+    if (!readJournal(JOURNAL_FAULTS, &version, payload) || (FAULTS_VERSION != version))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < FAULT_LOG_SIZE; i++)
+    {
+        fault_log[i].code       = payload[i * FAULT_ENTRY_SIZE];
+        fault_log[i].uptime_min = payload[i * FAULT_ENTRY_SIZE + 1] |
+                                  ((uint16_t)payload[i * FAULT_ENTRY_SIZE + 2] << 8);
+    }
+}
+
+// public:
+EFaultSeverity getFaultSeverity(EFault fault)
+{
+    if (FAULT_SENSOR_LOST > fault)
+    {
+        return FAULT_SEVERITY_RETRY;
+    }
+
+    if (FAULT_WATCHDOG_RESET > fault)
+    {
+        return FAULT_SEVERITY_SAFE_STOP;
+    }
+
+    return FAULT_SEVERITY_INFO;
+}
+
+// public:
+uint8_t getFaultIndex(EFault fault)
+{
+    uint8_t i = 0;
+
+    for (; i < FAULT_CODES_COUNT; i++)
+    {
+        if (fault == fault_codes[i])
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+// public:
+EFault getFaultCode(uint8_t index)
+{
+    return (FAULT_CODES_COUNT > index) ? (EFault)fault_codes[index] : FAULT_NONE;
+}
+
+// public:
+void raiseFault(EFault fault)
+{
+    uint32_t uptime_ms = getMillis();
+
+    fault_flags |= getFaultFlag(fault);
+
+    if ((FAULT_SEVERITY_SAFE_STOP == getFaultSeverity(fault)) && (FAULT_NONE == fault_latched))
+    {
+        fault_latched = fault;
+        setOutputsSafeState(true);
+    }
+
+    if (FAULT_SEVERITY_INFO != getFaultSeverity(fault))
+    {
+        fault_shown    = fault;
+        fault_shown_ms = uptime_ms;
+    }
+
+    if (logFault(fault, uptime_ms / 60000ul))
+    {
+        countFault(fault);
+    }
+}
+
+// public:
+EFault getLatchedFault()
+{
+    return fault_latched;
+}
+
+// public:
+EFault getDisplayedFault()
+{
+    if (FAULT_NONE != fault_latched)
+    {
+        return fault_latched;
+    }
+
+    if ((FAULT_NONE != fault_shown) && ((getMillis() - fault_shown_ms) < FAULT_DISPLAY_MS))
+    {
+        return fault_shown;
+    }
+
+    return FAULT_NONE;
+}
+
+// public:
+bool getFaultLogEntry(uint8_t index, SFaultLogEntry *entry)
+{
+    if ((FAULT_LOG_SIZE <= index) || (FAULT_NONE == fault_log[index].code))
+    {
+        return false;
+    }
+
+    *entry = fault_log[index];
+    return true;
+}
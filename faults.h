@@ -0,0 +1,101 @@
+/************************************************************************************************
+ * Faults:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Codes keep the numbers shown as Er<nn> by older firmware.
+// Severity follows from the range:
+//  0..39  retry     - the operation failed, the heater is off until it succeeds again
+//  40..79 safe stop - the session is stopped and the heater is forced off until reset
+//  80..   info      - logged only
+typedef enum
+{
+    FAULT_AHT20_INIT_START       = 0,
+    FAULT_AHT20_INIT_ADDRESS     = 1,
+    FAULT_AHT20_INIT_COMMAND     = 2,
+    // 11..23 are not raised anymore, a failed read raises its outermost step only
+    FAULT_AHT20_READ_BUSY        = 11,
+    FAULT_AHT20_READ_START       = 12,
+    FAULT_AHT20_READ_ADDRESS     = 13,
+    FAULT_AHT20_READ_DATA        = 14,
+    FAULT_AHT20_MEASURE_START    = 20,
+    FAULT_AHT20_MEASURE_ADDRESS  = 21,
+    FAULT_AHT20_MEASURE_COMMAND  = 22,
+    FAULT_AHT20_MEASURE_STATUS   = 23,
+    FAULT_AHT20_TRIGGER          = 30,
+    FAULT_AHT20_RESULT           = 31,
+
+    FAULT_SENSOR_LOST            = 40, // AHT20 failed FAULT_SENSOR_RETRIES times in a row
+    FAULT_POST_SENSOR            = 41, // see post.h
+    FAULT_NTC_RANGE              = 51,
+    FAULT_POST_NTC_OPEN          = 52,
+    FAULT_POST_NTC_SHORT         = 53,
+    FAULT_HEATER_NO_RISE         = 60, // see safety.h
+    FAULT_HEATER_OFF_RISE        = 61,
+    FAULT_SENSOR_MISMATCH        = 62,
+    FAULT_READINGS_STALE         = 63,
+    FAULT_POST_HEATER            = 64,
+    FAULT_OUTPUT_READBACK        = 70,
+
+    FAULT_WATCHDOG_RESET         = 80,
+    FAULT_POST_EEPROM            = 81,
+
+    FAULT_NONE                   = 0xFF
+} EFault;
+
+typedef enum
+{
+    FAULT_SEVERITY_RETRY,
+    FAULT_SEVERITY_SAFE_STOP,
+    FAULT_SEVERITY_INFO,
+} EFaultSeverity;
+
+#define FAULT_SENSOR_RETRIES  10
+
+// Codes which can be raised, counted in statistics and held off each by its own index in this
+// order. Others are neither logged nor counted:
+// 0, 1, 2, 30, 31, 40, 41, 51, 52, 53, 60, 61, 62, 63, 64, 70, 80, 81
+// A new code has to be added to fault_codes in faults.c, at the end to keep stored counters
+#define FAULT_CODES_COUNT     18
+
+// Newest first. Persisted in the journal as one record
+#define FAULT_LOG_SIZE        3
+// Each code is logged (and counted in statistics) once per this time at most, so a repeating
+// fault does not wear out the EEPROM
+#define FAULT_LOG_HOLDOFF_MIN 10
+#define FAULT_DISPLAY_MS      5000
+
+typedef struct
+{
+    uint8_t  code;       // EFault
+    uint16_t uptime_min; // since the boot it happened in
+} SFaultLogEntry;
+
+// FAULT_FLAG_* seen since boot
+extern uint8_t fault_flags;
+
+// Loads the log, must be called after initJournal()
+void initFaults();
+
+EFaultSeverity getFaultSeverity(EFault fault);
+
+// Index of the code among the raised ones, FAULT_CODES_COUNT if it is not one of them
+uint8_t getFaultIndex(EFault fault);
+EFault  getFaultCode(uint8_t index);
+
+// Records the fault, never blocks. Safe stop faults force the outputs to the safe state. Must be
+// called from the main loop
+void raiseFault(EFault fault);
+
+// The safe stop fault which is active, FAULT_NONE if there is none
+EFault getLatchedFault();
+
+// The latched fault or a recent one for FAULT_DISPLAY_MS, FAULT_NONE if there is nothing to show
+EFault getDisplayedFault();
+
+// False if there is no entry at index
+bool getFaultLogEntry(uint8_t index, SFaultLogEntry *entry);
@@ -0,0 +1,204 @@
+/************************************************************************************************
+ * History:
+ ************************************************************************************************/
+
+#include <history.h>
+
+#include <string.h>
+
+typedef struct
+{
+    uint16_t *samples;
+    uint8_t   size;
+    uint8_t   ratio;                    // samples of the previous tier per sample
+    uint8_t   head;                     // the oldest sample
+    uint8_t   count;
+    int8_t    base[HISTORY_CHANNELS];   // value of the oldest sample
+    int8_t    last[HISTORY_CHANNELS];   // value of the newest sample as it decodes
+    int16_t   sum[HISTORY_CHANNELS];    // of the samples being averaged
+    uint8_t   sum_count;
+} SHistoryTier;
+
+// Delta bits per channel
+const uint8_t delta_bits[HISTORY_CHANNELS]  = {5, 5, 6};
+const uint8_t delta_shift[HISTORY_CHANNELS] = {0, 5, 10};
+
+uint16_t history_1s[HISTORY_SIZE_1S];
+uint16_t history_1min[HISTORY_SIZE_1MIN];
+uint16_t history_1h[HISTORY_SIZE_1H];
+
+SHistoryTier history[HISTORY_TIERS_COUNT] =
+{
+    {history_1s,    HISTORY_SIZE_1S,    1},
+    {history_1min,  HISTORY_SIZE_1MIN,  60},
+    {history_1h,    HISTORY_SIZE_1H,    60},
+};
+
+// private:
+int8_t getDelta(uint16_t packed, uint8_t channel)
+{
+    uint8_t bits  = delta_bits[channel];
+    int8_t  delta = (packed >> delta_shift[channel]) & ((1 << bits) - 1);
+
+    // sign extension
+    if (delta & (1 << (bits - 1)))
+    {
+        delta -= 1 << bits;
+    }
+
+    return delta;
+}
+
+// private:
+void pushSample(SHistoryTier *this, const int8_t *values)
+{
+    uint16_t packed = 0;
+
+    if (0 == this->count)
+    {
+        memcpy(this->base, values, HISTORY_CHANNELS);
+        memcpy(this->last, values, HISTORY_CHANNELS);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++)
+        {
+            int8_t  limit = (1 << (delta_bits[i] - 1)) - 1;
+            int16_t delta = values[i] - this->last[i];
+
+            if (limit < delta)
+            {
+                delta = limit;
+            }
+            else if (-limit > delta)
+            {
+                delta = -limit;
+            }
+
+            this->last[i] += delta;
+            packed |= ((uint16_t)delta & ((1 << delta_bits[i]) - 1)) << delta_shift[i];
+        }
+    }
+
+    if (this->size == this->count)
+    {
+        // the next sample becomes the oldest one
+        this->head = (this->head + 1) % this->size;
+        this->count--;
+
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++)
+        {
+            this->base[i] += getDelta(this->samples[this->head], i);
+        }
+    }
+
+    this->samples[(this->head + this->count) % this->size] = packed;
+    this->count++;
+}
+
+// public:
+void clearHistory()
+{
+    for (uint8_t i = 0; i < HISTORY_TIERS_COUNT; i++)
+    {
+        history[i].head      = 0;
+        history[i].count     = 0;
+        history[i].sum_count = 0;
+        memset(history[i].sum, 0, sizeof(history[i].sum));
+    }
+}
+
+// public:
+void addHistorySample(const int8_t *values)
+{
+    int8_t sample[HISTORY_CHANNELS];
+
+    memcpy(sample, values, HISTORY_CHANNELS);
+
+    for (uint8_t t = 0; t < HISTORY_TIERS_COUNT; t++)
+    {
+        SHistoryTier *this = &history[t];
+
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++)
+        {
+            this->sum[i] += sample[i];
+        }
+
+        this->sum_count++;
+        if (this->ratio != this->sum_count)
+        {
+            return;
+        }
+
+        // average, rounded
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++)
+        {
+            int16_t sum = this->sum[i] + ((0 > this->sum[i]) ? -(this->ratio / 2) : (this->ratio / 2));
+            sample[i]    = sum / this->ratio;
+            this->sum[i] = 0;
+        }
+
+        this->sum_count = 0;
+
+        pushSample(this, sample);
+    }
+}
+
+// public:
+uint8_t getHistoryCount(EHistoryTier tier)
+{
+    return history[tier].count;
+}
+
+// public:
+bool getHistorySample(EHistoryTier tier, uint8_t index, int8_t *values)
+{
+    SHistoryTier *this = &history[tier];
+
+    if (this->count <= index)
+    {
+        return false;
+    }
+
+    memcpy(values, this->base, HISTORY_CHANNELS);
+
+    for (uint8_t n = 1; n <= index; n++)
+    {
+        uint16_t packed = this->samples[(this->head + n) % this->size];
+
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++)
+        {
+            values[i] += getDelta(packed, i);
+        }
+    }
+
+    return true;
+}
+
+// public:
+uint16_t getHistoryDelta(EHistoryTier tier, uint8_t index)
+{
+    SHistoryTier *this = &history[tier];
+
+    return this->samples[(this->head + index) % this->size];
+}
+
+// public:
+int16_t getHistoryTrend(EHistoryTier tier, EHistoryChannel channel, uint8_t samples)
+{
+    SHistoryTier *this = &history[tier];
+    int16_t       trend = 0;
+
+    if ((0 == samples) || (this->count <= samples))
+    {
+        return 0;
+    }
+
+    // sum of the last deltas is the change
+    for (uint8_t n = this->count - samples; n < this->count; n++)
+    {
+        trend += getDelta(this->samples[(this->head + n) % this->size], channel);
+    }
+
+    return trend;
+}
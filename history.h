@@ -0,0 +1,58 @@
+/************************************************************************************************
+ * History:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Session history of the sensor values in RAM. Samples go through tiers of decreasing resolution:
+// each tier averages HISTORY_RATIO_n samples of the previous one. A tier is a ring of 16-bit
+// samples holding deltas to the previous sample (5 bits temperature, 5 bits humidity, 6 bits
+// heater temperature) plus the absolute value of its oldest sample. Deltas out of range are
+// clamped and the error is carried to the next sample, so values catch up instead of drifting.
+//
+// Default tiers: 16 x 1 s, 32 x 1 min, 24 x 1 h (24 h) - 144 bytes of samples.
+
+typedef enum
+{
+    HISTORY_TEMPERATURE,
+    HISTORY_HUMIDITY,
+    HISTORY_HEATER_TEMP,
+    HISTORY_CHANNELS
+} EHistoryChannel;
+
+typedef enum
+{
+    HISTORY_TIER_1S,
+    HISTORY_TIER_1MIN,
+    HISTORY_TIER_1H,
+    HISTORY_TIERS_COUNT
+} EHistoryTier;
+
+#ifndef HISTORY_SIZE_1S
+#define HISTORY_SIZE_1S    16
+#endif
+#ifndef HISTORY_SIZE_1MIN
+#define HISTORY_SIZE_1MIN  32
+#endif
+#ifndef HISTORY_SIZE_1H
+#define HISTORY_SIZE_1H    24
+#endif
+
+void clearHistory();
+
+// Must be called every second with HISTORY_CHANNELS values
+void addHistorySample(const int8_t *values);
+
+uint8_t getHistoryCount(EHistoryTier tier);
+
+// index 0 is the oldest sample. False if there is no such sample
+bool getHistorySample(EHistoryTier tier, uint8_t index, int8_t *values);
+
+// Packed delta of the sample to the previous one, as stored
+uint16_t getHistoryDelta(EHistoryTier tier, uint8_t index);
+
+// Change of the channel over the last samples of the tier, 0 if there are not enough samples
+int16_t getHistoryTrend(EHistoryTier tier, EHistoryChannel channel, uint8_t samples);
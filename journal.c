@@ -0,0 +1,328 @@
+/************************************************************************************************
+ * Journal:
+ ************************************************************************************************/
+
+#include <journal.h>
+#include <crc16.h>
+#include <utilities.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <stm8s_flash.h>
+
+#define JOURNAL_NO_SLOT 0xFF
+
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  version;
+    uint16_t seq;
+    uint8_t  payload[JOURNAL_PAYLOAD_SIZE];
+    uint16_t crc; // over all previous fields, written last
+} SJournalRecord;
+
+typedef struct
+{
+    SJournalRecord  record;
+    JournalCallback callback;
+} SJournalWrite;
+
+uint8_t  journal_latest[JOURNAL_TYPES_MAX]; // slot of the newest record per type
+uint8_t  journal_head = 0;                  // slot for the next record
+uint16_t journal_seq  = 0;                  // sequence number of the next record
+uint8_t  journal_corrupt = 0;
+
+// Entry 0 is programmed while journal_busy is set. Shared with the EOP interrupt
+SJournalWrite    journal_queue[JOURNAL_QUEUE_MAX];
+volatile uint8_t journal_queue_count = 0;
+volatile bool    journal_busy        = false;
+uint8_t          journal_word        = 0;   // offset of the word being programmed
+
+// private:
+const SJournalRecord* getRecord(uint8_t slot)
+{
+    return (const SJournalRecord*)(JOURNAL_ADDRESS + (uint16_t)slot * JOURNAL_RECORD_SIZE);
+}
+
+// private:
+bool isRecordValid(const SJournalRecord *record)
+{
+    if ((0 == record->type) || (JOURNAL_TYPES_MAX < record->type))
+    {
+        return false;
+    }
+
+    return record->crc == calcCRC16((const uint8_t*)record, offsetof(SJournalRecord, crc));
+}
+
+// private:
+// Sequence numbers wrap, so compare them by distance
+bool isNewer(uint16_t seq, uint16_t than)
+{
+    return 0 < (int16_t)(seq - than);
+}
+
+// private:
+bool isSlotErased(const SJournalRecord *record)
+{
+    const uint8_t *data = (const uint8_t*)record;
+
+    for (uint8_t i = 0; i < JOURNAL_RECORD_SIZE; i++)
+    {
+        if (0 != data[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// private:
+bool isLatestSlot(uint8_t slot)
+{
+    for (uint8_t i = 0; i < JOURNAL_TYPES_MAX; i++)
+    {
+        if (slot == journal_latest[i])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// public:
+void initJournal()
+{
+    uint8_t newest = JOURNAL_NO_SLOT;
+
+    memset(journal_latest, JOURNAL_NO_SLOT, sizeof(journal_latest));
+    journal_corrupt = 0;
+
+    for (uint8_t slot = 0; slot < JOURNAL_SLOTS; slot++)
+    {
+        const SJournalRecord *record = getRecord(slot);
+
+        if (!isRecordValid(record))
+        {
+            if (!isSlotErased(record))
+            {
+                journal_corrupt++;
+            }
+            continue;
+        }
+
+        uint8_t *latest = &journal_latest[record->type - 1];
+
+        if ((JOURNAL_NO_SLOT == *latest) || isNewer(record->seq, getRecord(*latest)->seq))
+        {
+            *latest = slot;
+        }
+
+        if ((JOURNAL_NO_SLOT == newest) || isNewer(record->seq, getRecord(newest)->seq))
+        {
+            newest = slot;
+        }
+    }
+
+    if (JOURNAL_NO_SLOT == newest)
+    {
+        journal_head = 0;
+        journal_seq  = 0;
+    }
+    else
+    {
+        journal_head = (newest + 1) % JOURNAL_SLOTS;
+        journal_seq  = getRecord(newest)->seq + 1;
+    }
+}
+
+// public:
+bool isJournalEmpty()
+{
+    for (uint8_t i = 0; i < JOURNAL_TYPES_MAX; i++)
+    {
+        if (JOURNAL_NO_SLOT != journal_latest[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// public:
+uint8_t getJournalCorruptSlots()
+{
+    return journal_corrupt;
+}
+
+// public:
+bool readJournal(EJournalType type, uint8_t *version, uint8_t *payload)
+{
+    uint8_t slot = journal_latest[type - 1];
+
+    if (JOURNAL_NO_SLOT == slot)
+    {
+        return false;
+    }
+
+    const SJournalRecord *record = getRecord(slot);
+
+    *version = record->version;
+    memcpy(payload, record->payload, JOURNAL_PAYLOAD_SIZE);
+
+    return true;
+}
+
+// private:
+void programJournalWord()
+{
+    uint16_t address = JOURNAL_ADDRESS + (uint16_t)journal_head * JOURNAL_RECORD_SIZE + journal_word;
+    uint32_t word;
+
+    memcpy(&word, (const uint8_t*)&journal_queue[0].record + journal_word, 4);
+    FLASH_ProgramWord(address, word);
+}
+
+// private:
+// Starts programming of the queue head. Called with interrupts disabled
+void startJournalWrite()
+{
+    SJournalRecord *record = &journal_queue[0].record;
+
+    while (isLatestSlot(journal_head))
+    {
+        journal_head = (journal_head + 1) % JOURNAL_SLOTS;
+    }
+
+    record->seq = journal_seq;
+    record->crc = calcCRC16((const uint8_t*)record, offsetof(SJournalRecord, crc));
+
+    journal_busy = true;
+    journal_word = 0;
+
+    FLASH_Unlock(FLASH_MEMTYPE_DATA);
+    FLASH_ITConfig(ENABLE);
+
+    programJournalWord();
+}
+
+// private:
+// Advances programming after end of the previous word. Called with interrupts disabled
+void handleJournalEop()
+{
+    journal_word += 4;
+
+    // crc goes with the last word, so a record torn by power loss fails validation
+    if (JOURNAL_RECORD_SIZE > journal_word)
+    {
+        programJournalWord();
+        return;
+    }
+
+    FLASH_ITConfig(DISABLE);
+    FLASH_Lock(FLASH_MEMTYPE_DATA);
+
+    EJournalType    type     = journal_queue[0].record.type;
+    JournalCallback callback = journal_queue[0].callback;
+
+    // a slot which fails readback is left behind, the next write goes to a fresh one
+    bool result = isRecordValid(getRecord(journal_head));
+
+    if (result)
+    {
+        journal_latest[type - 1] = journal_head;
+    }
+
+    journal_head = (journal_head + 1) % JOURNAL_SLOTS;
+    journal_seq++;
+
+    journal_queue_count--;
+    memmove(&journal_queue[0], &journal_queue[1], journal_queue_count * sizeof(SJournalWrite));
+
+    journal_busy = false;
+
+    if (0 != callback)
+    {
+        callback(type, result);
+    }
+
+    if (0 != journal_queue_count)
+    {
+        startJournalWrite();
+    }
+}
+
+// public:
+bool writeJournal(EJournalType type, uint8_t version, const uint8_t *payload, JournalCallback callback)
+{
+    bool result = false;
+
+    CRITICAL
+    {
+        // a record still waiting in the queue is replaced, only the newest payload matters
+        uint8_t i = journal_busy ? 1 : 0;
+
+        while ((i < journal_queue_count) && (type != journal_queue[i].record.type))
+        {
+            i++;
+        }
+
+        if (JOURNAL_QUEUE_MAX > i)
+        {
+            SJournalWrite *write = &journal_queue[i];
+
+            write->record.type    = type;
+            write->record.version = version;
+            memcpy(write->record.payload, payload, JOURNAL_PAYLOAD_SIZE);
+            write->callback       = callback;
+
+            if (i == journal_queue_count)
+            {
+                journal_queue_count++;
+            }
+
+            if (!journal_busy)
+            {
+                startJournalWrite();
+            }
+
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+// public:
+bool isJournalBusy()
+{
+    return journal_busy;
+}
+
+// public:
+void flushJournal()
+{
+    while (journal_busy)
+    {
+        // polls EOP too, so it works before interrupts are enabled
+        CRITICAL
+        {
+            if (journal_busy && (RESET != FLASH_GetFlagStatus(FLASH_FLAG_EOP)))
+            {
+                handleJournalEop();
+            }
+        }
+    }
+}
+
+INTERRUPT_HANDLER(EEPROM_EEC_IRQHandler, 24)
+{
+    // reading of the status register clears EOP
+    if (RESET != FLASH_GetFlagStatus(FLASH_FLAG_EOP))
+    {
+        handleJournalEop();
+    }
+}
@@ -0,0 +1,67 @@
+/************************************************************************************************
+ * Journal:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stm8s.h>
+
+// Records are appended round-robin over the whole data EEPROM, so every write goes to the next
+// slot instead of rewriting the same bytes. Each record carries its type, payload version, 16-bit
+// sequence number and CRC-16. The newest valid record of a type wins; a slot holding the newest
+// record of any type is skipped, so a power loss during a write never destroys the last good copy.
+
+#ifndef JOURNAL_ADDRESS
+#define JOURNAL_ADDRESS      0x4000
+#endif
+#define JOURNAL_SIZE         640
+#define JOURNAL_RECORD_SIZE  16
+#define JOURNAL_SLOTS        (JOURNAL_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_PAYLOAD_SIZE 10
+
+// Types start from 1: erased EEPROM reads as 0x00
+typedef enum
+{
+    JOURNAL_SETTINGS = 1,
+    JOURNAL_CHECKPOINT,
+    JOURNAL_STATS_USAGE,
+    JOURNAL_STATS_COUNTERS,
+    JOURNAL_RESETS,
+    JOURNAL_FAULTS,
+    JOURNAL_STATS_FAULTS,   // fault counters, JOURNAL_PAYLOAD_SIZE per record
+    JOURNAL_STATS_FAULTS_2,
+
+    JOURNAL_TYPES_MAX = JOURNAL_STATS_FAULTS_2
+} EJournalType;
+
+#define JOURNAL_QUEUE_MAX    4
+
+// Called from the flash interrupt when a record is programmed. result is false if readback failed
+typedef void (*JournalCallback)(EJournalType type, bool result);
+
+// Scans EEPROM for the newest record of each type
+void initJournal();
+
+// True if EEPROM holds no valid record of any type
+bool isJournalEmpty();
+
+// Slots found by initJournal() which are neither erased nor a valid record. One is expected after
+// a power loss during a write or from the legacy settings block
+uint8_t getJournalCorruptSlots();
+
+// Copies payload of the newest record of type. False if there is none
+bool readJournal(EJournalType type, uint8_t *version, uint8_t *payload);
+
+// Queues record and returns at once. Each word is started from the end of programming interrupt
+// of the previous one. A queued record of the same type which is not being programmed yet is
+// replaced. False if the queue is full. callback may be 0
+bool writeJournal(EJournalType type, uint8_t version, const uint8_t *payload, JournalCallback callback);
+
+// True while a record is being programmed
+bool isJournalBusy();
+
+// Waits until the queue is empty. Works with interrupts disabled
+void flushJournal();
@@ -3,34 +3,117 @@
  ************************************************************************************************/
 
 #include <keys.h>
+#include <outputs.h>
 #include <utilities.h>
 
-#define LONG_PRESS_TIME_MS 2000
+#include <stm8s_exti.h>
 
-EKeyId    new_key_id    = KEY_NONE;
-EKeyEvent new_key_event = KEY_NOT_ACTIVE;
+#define KEY_SAMPLE_PERIOD_MS 5     // 4 equal samples are needed, i.e. 20 ms debounce
+#define KEY_PORTS_MAX        4
+#define KEY_EVENTS_MAX       4     // power of 2
+
+// Keys sharing a port are sampled by one IDR read and debounced in parallel: bit N of every
+// field belongs to pin N. cnt1:cnt0 is a 2 bit vertical counter per pin, counting samples which
+// differ from the debounced state.
+typedef struct
+{
+    GPIO_TypeDef* port;
+    uint8_t       mask;  // pins with keys
+    uint8_t       state; // debounced state, 1 - pressed
+    uint8_t       cnt0;
+    uint8_t       cnt1;
+} SKeyPort;
+
+SKeyPort key_ports[KEY_PORTS_MAX];
+uint8_t  key_ports_count = 0;
+
+typedef struct
+{
+    EKeyId    key;
+    EKeyEvent event;
+} SKeyEventItem;
+
+SKeyEventItem    key_events[KEY_EVENTS_MAX];
+volatile uint8_t key_events_head = 0;
+volatile uint8_t key_events_tail = 0;
 
 uint8_t keys_count = 0;
 
+const SKeyChord* key_chords        = 0;
+uint8_t          key_chords_count  = 0;
+
+SKeyTiming key_timing =
+{
+    2000, // long_press_ms
+    500,  // repeat_delay_ms
+    250,  // repeat_period_ms
+    50,   // repeat_min_period_ms
+    300,  // double_click_ms
+};
+
+volatile bool keys_scanning = false; // set by a key edge interrupt, cleared when keys are idle
+
+uint8_t  sample_timer_ms  = KEY_SAMPLE_PERIOD_MS;
+EKeyId   active_key       = KEY_NONE; // the key or chord whose press is being timed
+uint8_t  active_mask      = 0;        // bit N - key with id N is a part of the active press
+uint8_t  active_flags     = 0;
+uint16_t hold_time_ms     = 0;
+bool     long_reported    = false;
+uint16_t repeat_timer_ms  = 0;
+uint16_t repeat_period_ms = 0;
+EKeyId   click_key        = KEY_NONE; // single press waiting for a possible second one
+uint16_t click_timer_ms   = 0;
+
 // private:
 void initKey(SKeyHandler *this)
 {
-    this->time_ms = 0;
+    GPIO_Init(this->port_key, this->pin_key, GPIO_MODE_IN_PU_IT);
+
+    if (0 != this->port_led)
+    {
+        initOutput(this->port_led, this->pin_led, 1); // LEDs are active low
+    }
+}
 
-    GPIO_Init(this->port_key, this->pin_key, GPIO_MODE_IN_PU_NO_IT);
-    GPIO_Init(this->port_led, this->pin_led, GPIO_MODE_OUT_PP_LOW_FAST);
+// private:
+void addKeyToPort(SKeyHandler *this)
+{
+    uint8_t i = 0;
+
+    for (; i < key_ports_count; i++)
+    {
+        if (this->port_key == key_ports[i].port)
+        {
+            break;
+        }
+    }
+
+    if (i == key_ports_count)
+    {
+        if (KEY_PORTS_MAX == key_ports_count)
+        {
+            return;
+        }
+
+        key_ports[i].port  = this->port_key;
+        key_ports[i].mask  = 0;
+        key_ports[i].state = 0;
+        key_ports[i].cnt0  = 0;
+        key_ports[i].cnt1  = 0;
+        key_ports_count++;
+    }
 
-    writePin(this->port_led, this->pin_led, 1);
+    key_ports[i].mask |= this->pin_key;
 }
 
 // public:
 void setLedState(EKeyId key, bool state)
 {
-    for (uint8_t i = 0; 0 < keys_count; i++)
+    for (uint8_t i = 0; i < keys_count; i++)
     {
         if (key == keys[i].key_id)
         {
-            writePin(keys[i].port_led, keys[i].pin_led, !state);
+            setOutput(keys[i].port_led, keys[i].pin_led, !state);
             break;
         }
     }
@@ -39,54 +122,353 @@ void setLedState(EKeyId key, bool state)
 // private:
 void sendKeyState(EKeyId key, EKeyEvent state)
 {
-    new_key_id    = key;
-    new_key_event = state;
+    uint8_t next = (key_events_head + 1) & (KEY_EVENTS_MAX - 1);
+
+    if (next != key_events_tail) // drop the event if the queue is full
+    {
+        key_events[key_events_head].key   = key;
+        key_events[key_events_head].event = state;
+        key_events_head = next;
+    }
 }
 
 // public:
 bool getKeyState(EKeyId *key, EKeyEvent *state)
 {
-    if (KEY_NONE != new_key_id)
+    if (key_events_head != key_events_tail)
     {
-        *key   = new_key_id;
-        *state = new_key_event;
+        *key   = key_events[key_events_tail].key;
+        *state = key_events[key_events_tail].event;
 
-        new_key_id    = KEY_NONE;
-        new_key_event = KEY_NOT_ACTIVE;
+        key_events_tail = (key_events_tail + 1) & (KEY_EVENTS_MAX - 1);
         return true;
     }
     return false;
 }
 
+// public:
+void initKeyChords(const SKeyChord *chords, uint8_t count)
+{
+    key_chords       = chords;
+    key_chords_count = count;
+}
+
+// public:
+void setKeyTiming(const SKeyTiming *timing)
+{
+    key_timing = *timing;
+}
+
+// public:
+void setKeyFlags(EKeyId key, uint8_t flags)
+{
+    for (uint8_t i = 0; i < keys_count; i++)
+    {
+        if (key == keys[i].key_id)
+        {
+            keys[i].flags = flags;
+            break;
+        }
+    }
+}
+
 // private:
-void handleKey(SKeyHandler *this)
+SKeyHandler* findKey(GPIO_TypeDef* port, uint8_t pin)
 {
-    bool key_state = !GPIO_ReadInputPin(this->port_key, this->pin_key);
+    for (uint8_t i = 0; i < keys_count; i++)
+    {
+        if ((port == keys[i].port_key) && (pin == keys[i].pin_key))
+        {
+            return &keys[i];
+        }
+    }
 
-    if (key_state) // key pressed
+    return 0;
+}
+
+// private:
+EKeyId findChord(EKeyId key_a, EKeyId key_b)
+{
+    for (uint8_t i = 0; i < key_chords_count; i++)
     {
-        if (LONG_PRESS_TIME_MS > this->time_ms)
+        const SKeyChord *chord = &key_chords[i];
+
+        if (((key_a == chord->key_a) && (key_b == chord->key_b)) ||
+            ((key_a == chord->key_b) && (key_b == chord->key_a)))
         {
-            this->time_ms++;
+            return chord->chord_id;
         }
-        else if (LONG_PRESS_TIME_MS == this->time_ms)
+    }
+
+    return KEY_NONE;
+}
+
+// private:
+void flushClick()
+{
+    if (KEY_NONE != click_key)
+    {
+        sendKeyState(click_key, KEY_PRESSED);
+        click_key = KEY_NONE;
+    }
+}
+
+// private:
+void startPress(EKeyId key, uint8_t mask, uint8_t flags)
+{
+    active_key       = key;
+    active_mask      = mask;
+    active_flags     = flags;
+    hold_time_ms     = 0;
+    long_reported    = false;
+    repeat_timer_ms  = key_timing.repeat_delay_ms;
+    repeat_period_ms = key_timing.repeat_period_ms;
+
+    if (flags & KEY_FLAG_REPEAT)
+    {
+        sendKeyState(key, KEY_PRESSED);
+    }
+}
+
+// private:
+void releaseKey(EKeyId key)
+{
+    if ((active_flags & KEY_FLAG_REPEAT) || long_reported)
+    {
+        // already reported
+    }
+    else if (active_flags & KEY_FLAG_DOUBLE_CLICK)
+    {
+        if (key == click_key)
         {
-            sendKeyState(this->key_id, KEY_LONG_PRESSED);
-            this->time_ms++;
+            click_key = KEY_NONE;
+            sendKeyState(key, KEY_DOUBLE_CLICKED);
         }
         else
         {
-            // Do nothing. Event has already been reported.
+            flushClick();
+            click_key      = key;
+            click_timer_ms = key_timing.double_click_ms;
+        }
+    }
+    else
+    {
+        sendKeyState(key, KEY_PRESSED);
+    }
+
+    active_key  = KEY_NONE;
+    active_mask = 0;
+}
+
+// private:
+// Called only for debounced edges
+void handleKeyEdge(SKeyHandler *key, bool pressed)
+{
+    if (0 == key)
+    {
+        return;
+    }
+
+    uint8_t bit = 1 << key->key_id;
+
+    if (pressed)
+    {
+        if (KEY_NONE == active_key)
+        {
+            if (key->key_id != click_key)
+            {
+                flushClick();
+            }
+
+            startPress(key->key_id, bit, key->flags);
+        }
+        else if (active_mask == (1 << active_key)) // a single key is held, check for a chord
+        {
+            EKeyId chord = findChord(active_key, key->key_id);
+
+            if (KEY_NONE != chord)
+            {
+                startPress(chord, active_mask | bit, 0);
+            }
         }
     }
     else
     {
-        if ((0 != this->time_ms) && (LONG_PRESS_TIME_MS > this->time_ms))
+        // a chord ends with release of either of its keys
+        if (active_mask & bit)
+        {
+            releaseKey(active_key);
+        }
+    }
+}
+
+// private:
+void handleKeyTiming()
+{
+    if ((KEY_NONE != click_key) && (KEY_NONE == active_key))
+    {
+        if (KEY_SAMPLE_PERIOD_MS >= click_timer_ms)
+        {
+            flushClick();
+        }
+        else
+        {
+            click_timer_ms -= KEY_SAMPLE_PERIOD_MS;
+        }
+    }
+
+    if (KEY_NONE == active_key)
+    {
+        return;
+    }
+
+    if (active_flags & KEY_FLAG_REPEAT)
+    {
+        if (KEY_SAMPLE_PERIOD_MS < repeat_timer_ms)
         {
-            sendKeyState(this->key_id, KEY_PRESSED);
+            repeat_timer_ms -= KEY_SAMPLE_PERIOD_MS;
+            return;
         }
 
-        this->time_ms = 0;
+        sendKeyState(active_key, KEY_REPEATED);
+
+        repeat_period_ms -= repeat_period_ms >> 2;
+        if (key_timing.repeat_min_period_ms > repeat_period_ms)
+        {
+            repeat_period_ms = key_timing.repeat_min_period_ms;
+        }
+        repeat_timer_ms = repeat_period_ms;
+    }
+    else if (!long_reported)
+    {
+        hold_time_ms += KEY_SAMPLE_PERIOD_MS;
+
+        if (key_timing.long_press_ms <= hold_time_ms)
+        {
+            long_reported = true;
+            sendKeyState(active_key, KEY_LONG_PRESSED);
+        }
+    }
+}
+
+// private:
+void handleKeyPort(SKeyPort *this)
+{
+    uint8_t sample = (uint8_t)~this->port->IDR & this->mask; // keys are active low
+    uint8_t delta  = sample ^ this->state;
+
+    this->cnt1 = (this->cnt1 ^ this->cnt0) & delta;
+    this->cnt0 = ~this->cnt0 & delta;
+
+    uint8_t toggle = delta & ~(this->cnt0 | this->cnt1); // counter wrapped - stable change
+
+    if (0 == toggle)
+    {
+        return;
+    }
+
+    this->state ^= toggle;
+
+    for (uint8_t pin = 1; 0 != pin; pin <<= 1)
+    {
+        if (toggle & pin)
+        {
+            handleKeyEdge(findKey(this->port, pin), 0 != (this->state & pin));
+        }
+    }
+}
+
+// private:
+EXTI_Port_TypeDef getExtiPort(GPIO_TypeDef* port)
+{
+    if (GPIOA == port)
+    {
+        return EXTI_PORT_GPIOA;
+    }
+    else if (GPIOB == port)
+    {
+        return EXTI_PORT_GPIOB;
+    }
+    else if (GPIOC == port)
+    {
+        return EXTI_PORT_GPIOC;
+    }
+    else if (GPIOD == port)
+    {
+        return EXTI_PORT_GPIOD;
+    }
+
+    return EXTI_PORT_GPIOE;
+}
+
+// private:
+void setKeyInterrupts(bool enable)
+{
+    for (uint8_t i = 0; i < key_ports_count; i++)
+    {
+        if (enable)
+        {
+            key_ports[i].port->CR2 |= key_ports[i].mask;
+        }
+        else
+        {
+            key_ports[i].port->CR2 &= (uint8_t)~key_ports[i].mask;
+        }
+    }
+}
+
+// private:
+// First falling edge on a key pin starts scanning. Pin interrupts stay off while scanning, so
+// contact bounce doesn't cause interrupt storms.
+void wakeUpKeys()
+{
+    setKeyInterrupts(false);
+
+    if (!keys_scanning)
+    {
+        sample_timer_ms = KEY_SAMPLE_PERIOD_MS;
+        keys_scanning   = true;
+    }
+}
+
+// private:
+bool isAnyKeyDown()
+{
+    for (uint8_t i = 0; i < key_ports_count; i++)
+    {
+        if (0 != ((uint8_t)~key_ports[i].port->IDR & key_ports[i].mask))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// private:
+// Scanning stops when all keys are released, debounced and no timing is pending
+void checkKeysIdle()
+{
+    if ((KEY_NONE != active_key) || (KEY_NONE != click_key))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < key_ports_count; i++)
+    {
+        if (key_ports[i].state | key_ports[i].cnt0 | key_ports[i].cnt1)
+        {
+            return;
+        }
+    }
+
+    keys_scanning = false;
+    setKeyInterrupts(true);
+
+    // an edge between the last sample and enabling interrupts would be lost
+    if (isAnyKeyDown())
+    {
+        wakeUpKeys();
     }
 }
 
@@ -97,14 +479,56 @@ void initKeys(uint8_t count)
     for (uint8_t i = 0; i < keys_count; i++)
     {
         initKey(&keys[i]);
+        addKeyToPort(&keys[i]);
+    }
+
+    for (uint8_t i = 0; i < key_ports_count; i++)
+    {
+        EXTI_SetExtIntSensitivity(getExtiPort(key_ports[i].port), EXTI_SENSITIVITY_FALL_ONLY);
     }
 }
 
 // public:
 void handleKeys()
 {
-    for (uint8_t i = 0; i < keys_count; i++)
+    if (!keys_scanning)
+    {
+        return;
+    }
+
+    sample_timer_ms--;
+    if (0 != sample_timer_ms)
+    {
+        return;
+    }
+
+    sample_timer_ms = KEY_SAMPLE_PERIOD_MS;
+
+    for (uint8_t i = 0; i < key_ports_count; i++)
     {
-        handleKey(&keys[i]);
+        handleKeyPort(&key_ports[i]);
     }
+
+    handleKeyTiming();
+    checkKeysIdle();
+}
+
+INTERRUPT_HANDLER(EXTI_PORTA_IRQHandler, 3)
+{
+    wakeUpKeys();
+}
+
+INTERRUPT_HANDLER(EXTI_PORTB_IRQHandler, 4)
+{
+    wakeUpKeys();
+}
+
+INTERRUPT_HANDLER(EXTI_PORTC_IRQHandler, 5)
+{
+    wakeUpKeys();
+}
+
+INTERRUPT_HANDLER(EXTI_PORTD_IRQHandler, 6)
+{
+    wakeUpKeys();
 }
@@ -15,6 +15,8 @@ typedef enum
     KEY_POWER,
     KEY_MODE,
     KEY_UP,
+    // chords, reported as keys of their own:
+    KEY_POWER_MODE,
 } EKeyId;
 
 typedef enum
@@ -22,8 +24,19 @@ typedef enum
     KEY_NOT_ACTIVE,
     KEY_PRESSED,
     KEY_LONG_PRESSED,
+    KEY_REPEATED,
+    KEY_DOUBLE_CLICKED,
 } EKeyEvent;
 
+// Key reports KEY_PRESSED on press and then KEY_REPEATED while held, no long press
+#define KEY_FLAG_REPEAT       0x01
+// Two presses within double_click_ms report KEY_DOUBLE_CLICKED, a single press is reported
+// when the window expires
+#define KEY_FLAG_DOUBLE_CLICK 0x02
+
+// Key without LED
+#define GPIO_NO_LED 0, (GPIO_Pin_TypeDef)0
+
 typedef struct SKeyHandler
 {
     EKeyId           key_id;
@@ -31,9 +44,28 @@ typedef struct SKeyHandler
     GPIO_Pin_TypeDef pin_key;
     GPIO_TypeDef*    port_led;
     GPIO_Pin_TypeDef pin_led;
-    uint16_t         time_ms;
+    uint8_t          flags;
 } SKeyHandler;
 
+// Two keys held together. Their own events are suppressed, the chord reports KEY_PRESSED on
+// release and KEY_LONG_PRESSED as a normal key does.
+typedef struct
+{
+    EKeyId chord_id;
+    EKeyId key_a;
+    EKeyId key_b;
+} SKeyChord;
+
+// All times are in ms and are rounded to the key sampling period
+typedef struct
+{
+    uint16_t long_press_ms;
+    uint16_t repeat_delay_ms;      // from press to the first repeat
+    uint16_t repeat_period_ms;     // first repeat period, every repeat shortens it by 1/4
+    uint16_t repeat_min_period_ms; // period after acceleration
+    uint16_t double_click_ms;
+} SKeyTiming;
+
 extern SKeyHandler keys[];
 
 void initKey(SKeyHandler *this);
@@ -42,6 +74,17 @@ bool getKeyState(EKeyId *key, EKeyEvent *state);
 
 void setLedState(EKeyId key, bool state);
 
+// Keys wake up the scanner by falling edge interrupts. Must be called with interrupts disabled,
+// EXTI sensitivity can't be changed otherwise.
 void initKeys(uint8_t keys_count);
 
+void initKeyChords(const SKeyChord *chords, uint8_t count);
+
+void setKeyTiming(const SKeyTiming *timing);
+
+// Flags are taken at the press, a key being held keeps the old ones
+void setKeyFlags(EKeyId key, uint8_t flags);
+
+// Must be called every 1 ms. Does nothing until a key edge interrupt, then keys are sampled
+// every KEY_SAMPLE_PERIOD_MS by whole port reads until all of them are released.
 void handleKeys();
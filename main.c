@@ -11,27 +11,55 @@
 #include "aht20.h"
 #include <tm1621c.h>
 #include <keys.h>
+#include <outputs.h>
+#include <journal.h>
+#include <stats.h>
+#include <uart.h>
+#include <telemetry.h>
+#include <commands.h>
+#include <history.h>
+#include <modbus.h>
+#include <watchdog.h>
+#include <safety.h>
+#include <faults.h>
+#include <ntc.h>
+#include <post.h>
+#include <clock.h>
 
 #include <utilities.h>
+#include <actions.h>
 
 #include "stm8s.h"
 #include "stm8s_clk.h"
-#include "stm8s_adc1.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 /* Evalboard I/Os configuration */
 
+// Modbus uses the UART1 pins too
+#if defined(USE_MODBUS) && !defined(USE_UART1)
+#define USE_UART1
+#endif
+
 #define GPIO_BACKLIGHT    GPIOA, GPIO_PIN_2
+#ifdef USE_UART1
+// PD5/PD6 are UART1 TX/RX
+#define GPIO_LED_POWER    GPIO_NO_LED
+#define GPIO_LED_MODE     GPIO_NO_LED
+#else
 #define GPIO_LED_POWER    GPIOD, GPIO_PIN_6
 #define GPIO_LED_MODE     GPIOD, GPIO_PIN_5
+#endif
 #define GPIO_LED_UP       GPIOD, GPIO_PIN_3
 
-#define GPIO_DISP_CS      GPIOA, GPIO_PIN_1
-#define GPIO_DISP_WR      GPIOC, GPIO_PIN_5
-#define GPIO_DISP_DATA    GPIOC, GPIO_PIN_7
+// bound at compile time by the driver
+#define GPIO_DISP_CS      TM1621C_CS_PORT,   TM1621C_CS_PIN
+#define GPIO_DISP_WR      TM1621C_WR_PORT,   TM1621C_WR_PIN
+#define GPIO_DISP_DATA    TM1621C_DATA_PORT, TM1621C_DATA_PIN
 
 #define GPIO_I2C_SDA      GPIOB, GPIO_PIN_4
 #define GPIO_I2C_SCL      GPIOB, GPIO_PIN_5
@@ -53,13 +81,25 @@
 
 volatile uint32_t millis = 0;
 
-// Settings which are stored to eeprom:
+bool     boot_complete       = false; // sensor, POST and session start are done
+uint32_t boot_first_frame_us = 0;     // boot timing by getMicros()
+uint32_t boot_control_us     = 0;
+
+// Settings which are stored to eeprom. Layout changes must bump SETTINGS_VERSION and extend
+// migrateSettings(). Must fit JOURNAL_PAYLOAD_SIZE:
+#define SETTINGS_VERSION     1
+
+#define DEFAULT_HEATER_WATTS 150
+#define DEFAULT_MODBUS_ADDRESS 1
+
 typedef struct
 {
-    bool    use_beeper;
-    bool    start_power_state;
-    uint8_t start_temp_index;
-    uint8_t start_time_index;
+    bool     use_beeper;
+    bool     start_power_state;
+    uint8_t  start_temp_index;
+    uint8_t  start_time_index;
+    uint16_t heater_watts;      // used for energy statistics, not in the legacy layout
+    uint8_t  modbus_address;    // not in the legacy layout
 } SEeprom;
 
 SEeprom eeprom;
@@ -68,7 +108,7 @@ SEeprom eeprom;
 
 void handleTick1ms();
 
-void fatal(uint8_t err);
+void haltSafe();
 
 /* Private functions ---------------------------------------------------------*/
 /* Public functions ----------------------------------------------------------*/
@@ -94,11 +134,59 @@ void writePin(GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef PortPin, bool val)
  * Timers:
  ************************************************************************************************/
 
+#define TIMER2_PERIOD 1000
+
+// 1 us per count at any clock
+const uint8_t timer2_prescalers[CLOCK_MODES_COUNT] = {TIM2_PRESCALER_16, TIM2_PRESCALER_2};
+
+// Keeps the count across a clock change. The prescaler is reloaded by an update event, which
+// clears the counter and does not interrupt (URS)
+void retuneTimer2(EClockMode mode)
+{
+    uint16_t counter = TIM2_GetCounter();
+
+    // let it wrap first, the pending interrupt counts that millisecond
+    while (TIMER2_PERIOD - 2 < counter)
+    {
+        counter = TIM2_GetCounter();
+    }
+
+    TIM2_PrescalerConfig((TIM2_Prescaler_TypeDef)timer2_prescalers[mode], TIM2_PSCRELOADMODE_IMMEDIATE);
+    TIM2_SetCounter(counter);
+}
+
 void initTimer2()
 {
-    TIM2_TimeBaseInit(TIM2_PRESCALER_16, 1000);
+    TIM2_TimeBaseInit((TIM2_Prescaler_TypeDef)timer2_prescalers[getClockMode()], TIMER2_PERIOD);
+    TIM2_UpdateRequestConfig(TIM2_UPDATESOURCE_REGULAR);
     TIM2_ITConfig(TIM2_IT_UPDATE, ENABLE);
     TIM2_Cmd(ENABLE);
+
+    addClockHandler(retuneTimer2);
+}
+
+// Microseconds since initTimer2() from millis and the TIM2 counter (1 us per count). Wraps after
+// 71 minutes, meant for boot timing
+uint32_t getMicros()
+{
+    uint32_t ms;
+    uint16_t counter;
+    bool     pending;
+
+    CRITICAL
+    {
+        ms      = millis;
+        counter = TIM2_GetCounter();
+        pending = (SET == TIM2_GetFlagStatus(TIM2_FLAG_UPDATE));
+    }
+
+    // the counter has wrapped but the tick has not been counted yet
+    if (pending && (500 > counter))
+    {
+        ms++;
+    }
+
+    return ms * 1000ul + counter;
 }
 
 INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13)
@@ -108,89 +196,59 @@ INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13)
 
     handleKeys();
     handleTick1ms();
+    handleSafetyTick(getOutput(GPIO_HEATER), getOutput(GPIO_FAN));
+    handleOutputsTick();
+    handleWatchdogTick();
 }
 
 /************************************************************************************************
- * ADC1:
+ * Clock:
  ************************************************************************************************/
 
-void initADC()
-{
-    /*  Init GPIO for ADC1 */
-    GPIO_Init(GPIO_TEMP_SENSOR, GPIO_MODE_IN_FL_NO_IT);
-
-    /* Init ADC1 peripheral */
-    ADC1_Init(ADC1_CONVERSIONMODE_CONTINUOUS,
-              ADC1_CHANNEL_2,
-              ADC1_PRESSEL_FCPU_D2,
-              ADC1_EXTTRIG_TIM,
-              DISABLE,
-              ADC1_ALIGN_RIGHT,
-              ADC1_SCHMITTTRIG_CHANNEL2,
-              DISABLE);
+#define CLOCK_UART_QUIET_MS 1000
 
-    /* Enable EOC interrupt */
-//    ADC1_ITConfig(ADC1_IT_EOC, ENABLE);
-
-    /* Enable general interrupts */
-//    enableInterrupts();
-
-    /*Start Conversion */
-    ADC1_StartConversion();
+// A clock change garbles a byte on the line, so the operating point is kept while the UART is busy.
+// A Modbus master may poll at any time, the slave stays at CLOCK_ACTIVE
+bool canSwitchClock()
+{
+#if defined(USE_MODBUS)
+    return false;
+#elif defined(USE_UART1)
+    return isUARTQuiet(CLOCK_UART_QUIET_MS);
+#else
+    return true;
+#endif
 }
 
-typedef struct
+// Sensor reads, display updates and the boot run at CLOCK_ACTIVE
+void beginClockBurst()
 {
-    int32_t res;
-    uint8_t temp;
-} SResToTemp;
-
-SResToTemp res2temp[] =
-{
-    {383647l, 0},   // 0
-    {287573l, 5},   // 1
-    {217764l, 10},  // 2
-    {166500l, 15},  // 3
-    {128475l, 20},  // 4
-    {99500l,  25},  // 5
-    {75530l,  30},  // 6
-    {46050l,  40},  // 7
-    {31070l,  50},  // 8
-    {20800l , 60},  // 9
-    {14490l,  70},  // 10
-    {10000l,  80},  // 11
-    {7160l,   90},  // 12
-    {5220l,   100}, // 13
-    {3860l,   110}, // 14
-    {3316l,   120}, // 15
-    {2873l,   125}, // 16
-};
+    if (canSwitchClock())
+    {
+        setClockMode(CLOCK_ACTIVE);
+    }
+}
 
-int8_t getHeaterTemperature()
+// The main loop sleeps at CLOCK_IDLE between the bursts, the 1 ms tick runs at it too
+void endClockBurst()
 {
-    int32_t adc_val = ADC1_GetConversionValue();
-    int32_t v       = (adc_val * 3300l) / 1024l;
-    int32_t res     = 100000l * v / (3300l - v);
-    int32_t temp    = 50;
-    bool    found   = false;
-
-    for (uint8_t i = 0; i < ((sizeof(res2temp) / sizeof(SResToTemp)) - 1); i++)
+    if (boot_complete && canSwitchClock())
     {
-        if ((res2temp[i].res > res) && (res2temp[i+1].res <= res))
-        {
-            int32_t dR1  = res2temp[i+1].res  - res2temp[i].res;
-            int32_t dT1  = res2temp[i+1].temp - res2temp[i].temp;
-            int32_t dR2  = res - res2temp[i].res;
-            int32_t dT2  = dT1 * dR2 / dR1;
-            temp = res2temp[i].temp + dT2;
-            found = true;
-            break;
-        }
+        setClockMode(CLOCK_IDLE);
     }
+}
+
+/************************************************************************************************
+ * NTC:
+ ************************************************************************************************/
+
+int8_t getHeaterTemperature()
+{
+    int8_t temp = 50;
 
-    if (!found)
+    if (!convertNTC(readNTCRaw(), &temp))
     {
-        fatal(51);
+        raiseFault(FAULT_NTC_RANGE);
     }
     return temp;
 }
@@ -206,7 +264,7 @@ uint32_t beep_time_left_ms = 0;
 
 void setBeeperState(bool on)
 {
-    writePin(GPIO_BEEPER, on);
+    setOutput(GPIO_BEEPER, on);
 }
 
 void handleBeepTick()
@@ -243,13 +301,18 @@ void switchHeater(bool on)
     if (on != heater_state)
     {
         heater_state = on;
-        writePin(GPIO_HEATER, on);
+        setOutput(GPIO_HEATER, on);
+
+        if (on)
+        {
+            countHeaterCycle();
+        }
     }
 }
 
 inline void switchFan(bool on)
 {
-    writePin(GPIO_FAN, on);
+    setOutput(GPIO_FAN, on);
 }
 
 SKeyHandler keys[] =
@@ -259,6 +322,11 @@ SKeyHandler keys[] =
     {KEY_UP,    GPIO_KEY_UP,    GPIO_LED_UP,    0},
 };
 
+const SKeyChord key_chords[] =
+{
+    {KEY_POWER_MODE, KEY_POWER, KEY_MODE},
+};
+
 /**************************************************************************************************
  * MENU:
  *************************************************************************************************/
@@ -292,7 +360,8 @@ typedef enum
     SCREEN_ITEMS_COUNT
 } EScreenItem;
 
-bool      curr_on_off_state = false;
+bool          curr_on_off_state = false;
+volatile bool session_completed = false; // set by the tick when session time has elapsed
 EMenuItem curr_menu_state   = MENU_WORK;
 
 uint32_t    curr_time_left_ms = 10ul * 3600ul * 1000ul;
@@ -302,6 +371,53 @@ uint32_t    menu_active_timer = 0;
 
 const uint32_t c_menu_active_timeout_ms = 5ul * 1000ul;
 
+/************************************************************************************************
+ * Backlight:
+ ************************************************************************************************/
+
+// The display driver runs the backlight as a software PWM from the 1 ms tick (PA2 has no timer
+// channel). There is no ambient light sensor, so dimming depends on key presses only.
+#define BACKLIGHT_DIM_TIMEOUT_MS 30000ul
+#define BACKLIGHT_DIM_LEVEL      1  // of DISP_BACKLIGHT_LEVELS
+#define BACKLIGHT_WAKE_STEP_MS   15 // fade time per level
+#define BACKLIGHT_DIM_STEP_MS    150
+
+uint32_t backlight_activity_ms = 0;
+bool     backlight_dimmed      = false;
+
+// Full brightness, restarts the dim timeout
+void wakeBacklight()
+{
+    backlight_activity_ms = getMillis();
+
+    if (backlight_dimmed)
+    {
+        backlight_dimmed = false;
+        fadeBacklight(DISP_BACKLIGHT_LEVELS, BACKLIGHT_WAKE_STEP_MS);
+    }
+}
+
+// Dims the backlight while drying without key presses. It is off while the dryer is off
+void handleBacklight()
+{
+    if (!curr_on_off_state)
+    {
+        backlight_dimmed = false;
+        return;
+    }
+
+    // a fault has to be seen
+    if (FAULT_NONE != getDisplayedFault())
+    {
+        wakeBacklight();
+    }
+    else if (!backlight_dimmed && ((getMillis() - backlight_activity_ms) >= BACKLIGHT_DIM_TIMEOUT_MS))
+    {
+        backlight_dimmed = true;
+        fadeBacklight(BACKLIGHT_DIM_LEVEL, BACKLIGHT_DIM_STEP_MS);
+    }
+}
+
 void handleStateOff(EKeyId key);
 void handleStateOn(EKeyId key);
 
@@ -320,7 +436,6 @@ void handleStateOnOff(EKeyId key)
 void switchPowerOff()
 {
     curr_on_off_state = false;
-    clearDisp();
     setBacklightState(false);
     switchHeater(false);
     switchFan(false);
@@ -328,14 +443,28 @@ void switchPowerOff()
 
 void switchPowerOn()
 {
-    curr_time_left_ms = (uint32_t)(time_values[sizeof(time_values) - 1]) * 3600ul * 1000ul; // TODO: get index from EEPROM
-    // TODO: set temp and time to heater controller
+    // a safe stop fault keeps the dryer off until reset
+    if (FAULT_NONE != getLatchedFault())
+    {
+        return;
+    }
+
+    // the time selected by the menu, CMD_SET_TIME or Modbus before the start
+    CRITICAL
+    {
+        curr_time_left_ms = (uint32_t)time_values[curr_time_index] * 3600ul * 1000ul;
+        curr_time_left_ms += 100; // to show proper time in menu like 06:00
+    }
+    // TODO: set temp to heater controller
 
     curr_menu_state   = MENU_WORK;
     curr_on_off_state = true;
 
-    setBacklightState(true);
-    setItemStatus(DISP_WORK, true);
+    clearHistory();
+
+    backlight_dimmed      = false;
+    backlight_activity_ms = getMillis();
+    fadeBacklight(DISP_BACKLIGHT_LEVELS, BACKLIGHT_WAKE_STEP_MS);
 
     switchFan(true);
 }
@@ -344,64 +473,13 @@ void handleStateOff(EKeyId key)
 {
     if (KEY_POWER == key)
     {
-        switchPowerOn();
-    }
-}
-
-void showTime()
-{
-    setItemStatus(DISP_TEMP,    false);
-    setItemStatus(DISP_DEG_C,   false);
-    setItemStatus(DISP_PERCENT, false);
-
-    if (MENU_TIME == curr_menu_state)
-    {
-        setItemStatus(DISP_TIME,    true);
+        actionStart();
     }
-
-    setItemStatus(DISP_COLON,   true);
-
-    uint32_t time_min = curr_time_left_ms / 60000ul;
-
-    printDigits(time_min / 60, time_min % 60);
-}
-
-void showTemp()
-{
-    setItemStatus(DISP_TEMP,  true);
-    setItemStatus(DISP_DEG_C, true);
-
-    printDigits(temp_values[curr_temp_index], 0xFF);
-}
-
-void showHeaterTemp()
-{
-    setItemStatus(DISP_TIME,    false);
-    setItemStatus(DISP_COLON,   false);
-
-    setItemStatus(DISP_WORK,    false);
-    setItemStatus(DISP_DEG_C,   false);
-    setItemStatus(DISP_PERCENT, false);
-
-    setItemStatus(DISP_WORK,    true);
-
-    printNumberWithPreffix(0b1110110, getHeaterTemperature()); // 0b1110110 = "H"
 }
 
 uint8_t curr_temperature = 0;
 uint8_t curr_humidity    = 0;
-
-void showCurrTempHum()
-{
-    setItemStatus(DISP_TIME,    false);
-    setItemStatus(DISP_COLON,   false);
-
-    setItemStatus(DISP_WORK,    true);
-    setItemStatus(DISP_DEG_C,   true);
-    setItemStatus(DISP_PERCENT, true);
-
-    printDigits(curr_temperature, curr_humidity);
-}
+int8_t  curr_heater_temp = 0;
 
 void handleTick1ms()
 {
@@ -413,6 +491,7 @@ void handleTick1ms()
         }
         else
         {
+            session_completed = true;
             switchPowerOff();
         }
 
@@ -436,221 +515,754 @@ void handleTick1ms()
             {
                 curr_menu_state   = MENU_WORK;
                 main_screen_timer = 1;
-                setItemStatus(DISP_TIME,    false);
-                setItemStatus(DISP_TEMP,    false);
-                setItemStatus(DISP_COLON,   false);
-                setItemStatus(DISP_WORK,    false);
-                setItemStatus(DISP_DEG_C,   false);
-                setItemStatus(DISP_PERCENT, false);
-
-                setItemStatus(DISP_WORK,    true);
             }
         }
     }
 
     handleBeepTick();
+    handleDispTick();
 }
 
-void showWorkScreen()
+/**************************************************************************************************
+ * STATS PAGE:
+ *************************************************************************************************/
+
+// Hidden page with lifetime statistics, opened by long press of POWER+MODE. UP shows the next
+// value, any other key or 10 s without keys closes it. Every fault code which has been counted
+// gets a page of its own after the total.
+typedef enum
 {
-    switch (curr_screen)
-    {
-        case SCREEN_TEMP_HUM:
-            showCurrTempHum();
-            break;
-        case SCREEN_TIME:
-            showTime();
-            break;
-        case SCREEN_HEATER_TEMP:
-            showHeaterTemp();
-            break;
-        default:
-            curr_screen = SCREEN_TEMP_HUM;
-            showCurrTempHum();
-            break;
-    }
+    STATS_PAGE_HOURS,
+    STATS_PAGE_ENERGY,
+    STATS_PAGE_SESSIONS,
+    STATS_PAGE_CYCLES,
+    STATS_PAGE_FAULTS,
+    STATS_PAGE_FAULT_CODES,
+    STATS_PAGES_COUNT = STATS_PAGE_FAULT_CODES + FAULT_CODES_COUNT,
+
+    STATS_PAGE_NONE = 0xFF
+} EStatsPage;
+
+#define STATS_PAGE_TIMEOUT_MS 10000ul
+#define STATS_SCROLL_STEP_MS  400
+
+uint8_t  stats_page         = STATS_PAGE_NONE;
+uint32_t stats_page_timeout = 0;
+
+void openStatsPage(uint8_t page)
+{
+    stats_page         = page;
+    stats_page_timeout = millis + STATS_PAGE_TIMEOUT_MS;
 }
 
-void handleStateOn(EKeyId key)
+void handleStatsPageKey(EKeyId key, EKeyEvent event)
 {
-    switch (key)
+    if (KEY_PRESSED != event)
     {
-        case KEY_POWER:
-            // TODO: switch heater off
-            switchPowerOff();
-            break;
+        return;
+    }
 
-        case KEY_MODE:
-            clearDisp();
+    beep(BEEP_SHORT_TIME_MS);
 
-            curr_menu_state++;
-            menu_active_timer = c_menu_active_timeout_ms;
+    if (KEY_UP == key)
+    {
+        const SStats *stats = getStats();
+        uint8_t       page  = stats_page;
 
-            if (MENU_ITEMS_COUNT == curr_menu_state)
-            {
-                curr_menu_state = 0;
-            }
+        do
+        {
+            page = (page + 1) % STATS_PAGES_COUNT;
+        }
+        while ((STATS_PAGE_FAULT_CODES <= page) && (0 == stats->faults[page - STATS_PAGE_FAULT_CODES]));
 
-            switch (curr_menu_state)
-            {
-                case MENU_TEMP:
-                    // TODO: turn heater off
-                    showTemp();
-                    break;
+        openStatsPage(page);
+    }
+    else
+    {
+        stats_page = STATS_PAGE_NONE;
+    }
+}
 
-                case MENU_TIME:
-                    // TODO: turn heater off
-                    showTime();
-                    break;
+void handleStatsPageTimeout()
+{
+    if ((STATS_PAGE_NONE != stats_page) && (stats_page_timeout <= millis))
+    {
+        stats_page = STATS_PAGE_NONE;
+    }
+}
 
-                case MENU_WORK:
-                    // TODO: turn on heater
-                    setItemStatus(DISP_WORK, true);
-                    // temperature will be shown in the main loop
-                    break;
-            }
-            break;
+uint16_t saturate16(uint32_t value)
+{
+    return (0xFFFF < value) ? 0xFFFF : (uint16_t)value;
+}
 
-        case KEY_UP:
-            menu_active_timer = c_menu_active_timeout_ms;
+void renderStatsPage(uint8_t page)
+{
+    const SStats *stats = getStats();
 
-            switch (curr_menu_state)
-            {
-                case MENU_TEMP:
-                    curr_temp_index++;
-                    if (sizeof(temp_values) <= curr_temp_index)
-                    {
-                        curr_temp_index = 0;
-                    }
-                    showTemp();
-                    break;
+    switch (page)
+    {
+        case STATS_PAGE_HOURS:
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "HOUR %u", saturate16(stats->heater_on_s / 3600));
+            break;
 
-                case MENU_TIME:
-                {
-                    uint32_t time_hours = (curr_time_left_ms + 15000ul) / 3600000ul;
-                    uint8_t  new_index  = 0;
-                    for (uint8_t i = 0; i < sizeof(time_values); i++)
-                    {
-                        if (time_values[i] > time_hours)
-                        {
-                            new_index       = i;
-                            curr_time_index = i;
-                            break;
-                        }
-                    }
+        case STATS_PAGE_ENERGY:
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "KWH %u", saturate16(stats->energy_wh / 1000));
+            break;
 
-                    curr_time_left_ms = time_values[new_index];
-                    curr_time_left_ms *= 3600ul * 1000ul;
-                    curr_time_left_ms += 100; // to show proper time in menu like 06:00
+        case STATS_PAGE_SESSIONS:
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "SESS %u", stats->sessions);
+            break;
 
-                    showTime();
-                    break;
-                }
+        case STATS_PAGE_CYCLES:
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "CYCL %u", saturate16(stats->heater_cycles));
+            break;
 
-                case MENU_WORK:
-                    // do nothing
-                    break;
+        case STATS_PAGE_FAULTS:
+        {
+            uint16_t total = 0;
 
-                default:
-                    // do nothing
-                    break;
+            for (uint8_t i = 0; i < STATS_FAULT_COUNTERS; i++)
+            {
+                total += stats->faults[i];
             }
+
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "FLT %u", total);
             break;
+        }
 
         default:
-            // do nothing
+            page -= STATS_PAGE_FAULT_CODES;
+            scrollFormat(STATS_SCROLL_STEP_MS, true, "Er%02u %u", getFaultCode(page), stats->faults[page]);
             break;
     }
 }
 
 /**************************************************************************************************
- * EEPROM:
+ * VIEW:
  *************************************************************************************************/
 
-void readFromEeprom()
+typedef enum
 {
-    uint8_t *eeprom_addr = (uint8_t*)0x4000;
-    uint8_t crc          = 0;
-    uint8_t i            = 0;
-    uint8_t *buffer      = (uint8_t*)&eeprom;
+    VIEW_OFF,
+    VIEW_TEMP_HUM,
+    VIEW_TIME,
+    VIEW_HEATER_TEMP,
+    VIEW_MENU_TEMP,
+    VIEW_MENU_TIME,
+    VIEW_STATS,
+    VIEW_FAULT,
+    VIEW_SPLASH,
+} EView;
+
+// Everything shown on the LCD. Only fields used by the active view are filled in, so a change
+// of any field means the LCD content changes.
+typedef struct
+{
+    uint8_t  view;
+    int8_t   temperature;
+    uint8_t  humidity;
+    int8_t   heater_temp;
+    uint8_t  temp_setpoint;
+    uint8_t  time_left_hours;
+    uint8_t  time_left_min;
+    uint8_t  stats_page;
+    uint8_t  fault;
+    uint8_t  reset_cause;
+} SViewModel;
+
+SViewModel rendered_view;
+bool       rendered_view_valid = false;
+
+void buildViewTime(SViewModel *view)
+{
+    uint16_t time_min = curr_time_left_ms / 60000ul;
+
+    view->time_left_hours = time_min / 60;
+    view->time_left_min   = time_min % 60;
+}
 
-    for (i = 0; i < sizeof(eeprom); i++)
+void buildView(SViewModel *view)
+{
+    memset(view, 0, sizeof(SViewModel));
+
+    // faults are shown over everything, without blocking the main loop
+    if (FAULT_NONE != getDisplayedFault())
     {
-        buffer[i] = eeprom_addr[i];
-        crc      += eeprom_addr[i];
+        view->view  = VIEW_FAULT;
+        view->fault = getDisplayedFault();
+        return;
     }
 
-    if (crc != eeprom_addr[i])
+    // all segments on while booting, a check of the LCD as well. Reset cause is shown instead if
+    // the MCU has been reset
+    if (!boot_complete)
     {
-        // set default values:
-        eeprom.use_beeper        = true;
-        eeprom.start_power_state = false;
-        eeprom.start_temp_index  = 0;
-        eeprom.start_time_index  = 0;
+        view->view        = VIEW_SPLASH;
+        view->reset_cause = getResetCause();
+        return;
     }
 
-    curr_temp_index   = eeprom.start_temp_index;
-    curr_time_index   = eeprom.start_time_index;
+    if (STATS_PAGE_NONE != stats_page)
+    {
+        view->view       = VIEW_STATS;
+        view->stats_page = stats_page;
+        return;
+    }
 
-    curr_time_left_ms = time_values[curr_temp_index];
-}
+    if (!curr_on_off_state)
+    {
+        view->view = VIEW_OFF;
+        return;
+    }
 
-void storeToEeprom()
-{
-    uint16_t eeprom_addr = 0x4000;
-    uint8_t *buffer      = (uint8_t*)&eeprom;
-    uint8_t crc          = 0;
-    uint8_t i            = 0;
+    switch (curr_menu_state)
+    {
+        case MENU_TEMP:
+            view->view          = VIEW_MENU_TEMP;
+            view->temp_setpoint = temp_values[curr_temp_index];
+            return;
 
-    FLASH_Unlock(FLASH_MEMTYPE_DATA);
+        case MENU_TIME:
+            view->view          = VIEW_MENU_TIME;
+            buildViewTime(view);
+            return;
 
-    for (i = 0; i < sizeof(eeprom); i++)
-    {
-        FLASH_ProgramByte(eeprom_addr + i, buffer[i]);
-        crc += buffer[i];
+        default:
+            break;
     }
 
-    FLASH_ProgramByte(eeprom_addr + i, crc);
+    switch (curr_screen)
+    {
+        case SCREEN_TIME:
+            view->view          = VIEW_TIME;
+            buildViewTime(view);
+            break;
+
+        case SCREEN_HEATER_TEMP:
+            view->view          = VIEW_HEATER_TEMP;
+            view->heater_temp   = curr_heater_temp;
+            break;
 
-    FLASH_Lock(FLASH_MEMTYPE_DATA);
+        default:
+            view->view          = VIEW_TEMP_HUM;
+            view->temperature   = curr_temperature;
+            view->humidity      = curr_humidity;
+            break;
+    }
 }
 
-/************************************************************************************************
- * MAIN:
- ************************************************************************************************/
+void setViewIcons(bool deg_c, bool percent, bool temp, bool work, bool colon, bool time)
+{
+    setItemStatus(DISP_DEG_C,   deg_c);
+    setItemStatus(DISP_PERCENT, percent);
+    setItemStatus(DISP_TEMP,    temp);
+    setItemStatus(DISP_WORK,    work);
+    setItemStatus(DISP_COLON,   colon);
+    setItemStatus(DISP_TIME,    time);
+}
 
-void main(void)
+void renderView(const SViewModel *view)
 {
-    /* Initialization of the clock */
-    CLK_HSICmd(ENABLE);
-    CLK_HSIPrescalerConfig(CLK_PRESCALER_HSIDIV1);
-    CLK_SYSCLKConfig(CLK_PRESCALER_CPUDIV1);
+    if (VIEW_STATS != view->view)
+    {
+        stopScroll();
+    }
 
-    readFromEeprom();
+    switch (view->view)
+    {
+        case VIEW_TEMP_HUM:
+            setViewIcons(true, true, false, true, false, false);
+            printDigits(view->temperature, view->humidity);
+            break;
 
-    writePin(GPIO_LED_POWER, 1);
-    writePin(GPIO_LED_MODE,  1);
-    writePin(GPIO_LED_UP,    1);
+        case VIEW_TIME:
+            setViewIcons(false, false, false, true, true, false);
+            printDigits(view->time_left_hours, view->time_left_min);
+            break;
 
-    initTimer2();
-    enableInterrupts();
+        case VIEW_HEATER_TEMP:
+            setViewIcons(false, false, false, true, false, false);
+            printFormat("H%3d", view->heater_temp);
+            break;
 
-    initTM1621C(GPIO_DISP_CS, GPIO_DISP_WR, GPIO_DISP_DATA, GPIO_BACKLIGHT);
-    setBacklightState(false);
-    clearDisp();
+        case VIEW_MENU_TEMP:
+            clearDisp();
+            setViewIcons(true, false, true, false, false, false);
+            printDigits(view->temp_setpoint, 0xFF);
+            break;
 
-    const uint8_t keys_count = sizeof(keys)/sizeof(SKeyHandler);
-    initKeys(keys_count);
+        case VIEW_MENU_TIME:
+            setViewIcons(false, false, false, false, true, true);
+            printDigits(view->time_left_hours, view->time_left_min);
+            break;
+
+        case VIEW_STATS:
+            clearDisp();
+            setViewIcons(false, false, false, false, false, false);
+            renderStatsPage(view->stats_page);
+            break;
+
+        case VIEW_FAULT:
+            setViewIcons(false, false, false, false, false, false);
+            printErr(view->fault);
+            break;
+
+        case VIEW_SPLASH:
+            if (RESET_POWER_ON != view->reset_cause)
+            {
+                setViewIcons(false, false, false, false, false, false);
+                printFormat("rS%02u", view->reset_cause);
+            }
+            else
+            {
+                setViewIcons(true, true, true, true, true, true);
+                printString("8888");
+            }
+            break;
+
+        default:
+            clearDisp();
+            break;
+    }
+
+    // the value being edited blinks
+    if ((VIEW_MENU_TEMP == view->view) || (VIEW_MENU_TIME == view->view))
+    {
+        setDigitBlinkMask(0b0011);
+    }
+    else
+    {
+        setDigitBlinkMask(0);
+    }
+}
+
+// Redraws the LCD only if the view model differs from the last rendered one
+void updateView()
+{
+    SViewModel view;
+
+    buildView(&view);
+
+    if (rendered_view_valid && (0 == memcmp(&view, &rendered_view, sizeof(SViewModel))))
+    {
+        return;
+    }
+
+    beginClockBurst();
+    beginDispUpdate();
+    renderView(&view);
+    commitDispUpdate();
+
+    rendered_view       = view;
+    rendered_view_valid = true;
+}
+
+void handleStateOn(EKeyId key)
+{
+    switch (key)
+    {
+        case KEY_POWER:
+            actionStop();
+            break;
+
+        case KEY_MODE:
+            curr_menu_state++;
+            menu_active_timer = c_menu_active_timeout_ms;
+
+            if (MENU_ITEMS_COUNT == curr_menu_state)
+            {
+                curr_menu_state = 0;
+            }
+            break;
+
+        case KEY_UP:
+            menu_active_timer = c_menu_active_timeout_ms;
+
+            switch (curr_menu_state)
+            {
+                case MENU_TEMP:
+                    actionSetSetpoint(temp_values[(curr_temp_index + 1) % sizeof(temp_values)]);
+                    break;
+
+                case MENU_TIME:
+                {
+                    uint32_t time_hours = (curr_time_left_ms + 15000ul) / 3600000ul;
+                    uint8_t  new_index  = 0;
+                    for (uint8_t i = 0; i < sizeof(time_values); i++)
+                    {
+                        if (time_values[i] > time_hours)
+                        {
+                            new_index = i;
+                            break;
+                        }
+                    }
+
+                    actionSetTime(time_values[new_index]);
+                    break;
+                }
+
+                case MENU_WORK:
+                    // do nothing
+                    break;
+
+                default:
+                    // do nothing
+                    break;
+            }
+            break;
+
+        default:
+            // do nothing
+            break;
+    }
+}
+
+/**************************************************************************************************
+ * EEPROM:
+ *************************************************************************************************/
+
+// Layout written by firmware before the journal: SEeprom at 0x4000 followed by additive checksum
+#define LEGACY_EEPROM_ADDRESS 0x4000
+#define LEGACY_VERSION        0
+
+#define LEGACY_EEPROM_SIZE    4
+
+void setDefaultSettings()
+{
+    eeprom.use_beeper        = true;
+    eeprom.start_power_state = false;
+    eeprom.start_temp_index  = 0;
+    eeprom.start_time_index  = 0;
+    eeprom.heater_watts      = DEFAULT_HEATER_WATTS;
+    eeprom.modbus_address    = DEFAULT_MODBUS_ADDRESS;
+}
+
+// Converts payload stored by older firmware to the current layout in place
+bool migrateSettings(uint8_t version, uint8_t *payload)
+{
+    switch (version)
+    {
+        case LEGACY_VERSION:
+        {
+            uint16_t heater_watts = DEFAULT_HEATER_WATTS;
+            memcpy(&payload[offsetof(SEeprom, heater_watts)], &heater_watts, sizeof(heater_watts));
+            payload[offsetof(SEeprom, modbus_address)] = DEFAULT_MODBUS_ADDRESS;
+            return true;
+        }
+
+        case SETTINGS_VERSION:
+            return true;
+
+        default:
+            return false;
+    }
+}
 
-    initADC();
+// Reads settings of the legacy layout. Erased EEPROM (all zeros) passes the checksum, so it is
+// rejected to get defaults
+bool readLegacyEeprom(uint8_t *payload)
+{
+    uint8_t *eeprom_addr = (uint8_t*)LEGACY_EEPROM_ADDRESS;
+    uint8_t crc          = 0;
+    uint8_t all          = 0;
+    uint8_t i            = 0;
 
-    GPIO_Init(GPIO_HEATER, GPIO_MODE_OUT_PP_LOW_FAST);
-    GPIO_Init(GPIO_FAN,    GPIO_MODE_OUT_PP_LOW_FAST);
-    GPIO_Init(GPIO_BEEPER, GPIO_MODE_OUT_PP_LOW_FAST);
+    for (i = 0; i < LEGACY_EEPROM_SIZE; i++)
+    {
+        payload[i] = eeprom_addr[i];
+        crc       += eeprom_addr[i];
+        all       |= eeprom_addr[i];
+    }
 
-    delayMs(40);
+    return (0 != all) && (crc == eeprom_addr[i]);
+}
 
-    if (eeprom.start_power_state)
+void storeToEeprom()
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE] = {0};
+
+    memcpy(payload, &eeprom, sizeof(eeprom));
+    writeJournal(JOURNAL_SETTINGS, SETTINGS_VERSION, payload, 0);
+}
+
+void readFromEeprom()
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE] = {0};
+    uint8_t version                       = SETTINGS_VERSION;
+    bool    valid                         = false;
+    bool    store                         = false;
+
+    initJournal();
+
+    if (readJournal(JOURNAL_SETTINGS, &version, payload))
+    {
+        valid = true;
+        store = (SETTINGS_VERSION != version);
+    }
+    else if (isJournalEmpty() && readLegacyEeprom(payload))
+    {
+        valid   = true;
+        store   = true;
+        version = LEGACY_VERSION;
+    }
+
+    if (valid && migrateSettings(version, payload))
+    {
+        memcpy(&eeprom, payload, sizeof(eeprom));
+    }
+    else
+    {
+        setDefaultSettings();
+        store = false;
+    }
+
+    // migrated settings are rewritten once so older layouts are not parsed on every boot
+    if (store)
+    {
+        storeToEeprom();
+        flushJournal();
+    }
+
+    curr_temp_index   = eeprom.start_temp_index;
+    curr_time_index   = eeprom.start_time_index;
+
+    curr_time_left_ms = time_values[curr_temp_index];
+}
+
+/************************************************************************************************
+ * CHECKPOINT:
+ ************************************************************************************************/
+
+// Drying session state which survives power loss. With 40 journal slots and one record per
+// 5 minutes each EEPROM cell is written once per ~3 hours, far below its endurance.
+#define CHECKPOINT_VERSION   1
+#define CHECKPOINT_PERIOD_MS (5ul * 60ul * 1000ul)
+
+typedef struct
+{
+    uint32_t time_left_ms;
+    uint8_t  temp_index;
+    uint8_t  time_index;
+    bool     active;
+} SCheckpoint;
+
+bool     checkpoint_active = false; // session state of the last stored checkpoint
+uint32_t checkpoint_timer  = 0;
+
+void storeCheckpoint()
+{
+    uint8_t     payload[JOURNAL_PAYLOAD_SIZE] = {0};
+    SCheckpoint checkpoint;
+
+    CRITICAL
+    {
+        checkpoint.time_left_ms = curr_time_left_ms;
+    }
+
+    checkpoint.temp_index = curr_temp_index;
+    checkpoint.time_index = curr_time_index;
+    checkpoint.active     = curr_on_off_state;
+
+    memcpy(payload, &checkpoint, sizeof(checkpoint));
+
+    if (writeJournal(JOURNAL_CHECKPOINT, CHECKPOINT_VERSION, payload, 0))
+    {
+        checkpoint_active = checkpoint.active;
+        checkpoint_timer  = millis + CHECKPOINT_PERIOD_MS;
+    }
+}
+
+// Called every second. Session start and end are stored at once, running session periodically
+void handleCheckpoint()
+{
+    if (checkpoint_active != curr_on_off_state)
+    {
+        storeCheckpoint();
+    }
+    else if (curr_on_off_state && (checkpoint_timer <= millis))
+    {
+        storeCheckpoint();
+    }
+}
+
+// Restarts session interrupted by power loss. False if there is none
+bool resumeCheckpoint()
+{
+    uint8_t     payload[JOURNAL_PAYLOAD_SIZE];
+    uint8_t     version;
+    SCheckpoint checkpoint;
+
+    if (!readJournal(JOURNAL_CHECKPOINT, &version, payload) || (CHECKPOINT_VERSION != version))
+    {
+        return false;
+    }
+
+    memcpy(&checkpoint, payload, sizeof(checkpoint));
+
+    if (!checkpoint.active ||
+        (sizeof(temp_values) <= checkpoint.temp_index) ||
+        (sizeof(time_values) <= checkpoint.time_index))
+    {
+        return false;
+    }
+
+    curr_temp_index = checkpoint.temp_index;
+    curr_time_index = checkpoint.time_index;
+
+    switchPowerOn();
+
+    CRITICAL
+    {
+        curr_time_left_ms = checkpoint.time_left_ms;
+    }
+
+    checkpoint_active = true;
+    checkpoint_timer  = millis + CHECKPOINT_PERIOD_MS;
+
+    return true;
+}
+
+/************************************************************************************************
+ * ACTIONS:
+ ************************************************************************************************/
+
+void actionStart()
+{
+    // POST drives the heater and fan itself
+    if (!curr_on_off_state && boot_complete)
+    {
+        switchPowerOn();
+    }
+}
+
+void actionStop()
+{
+    if (curr_on_off_state)
+    {
+        switchPowerOff();
+    }
+}
+
+bool actionSetSetpoint(uint8_t temp)
+{
+    for (uint8_t i = 0; i < sizeof(temp_values); i++)
+    {
+        if (temp == temp_values[i])
+        {
+            curr_temp_index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool actionSetTime(uint8_t hours)
+{
+    for (uint8_t i = 0; i < sizeof(time_values); i++)
+    {
+        if (hours == time_values[i])
+        {
+            curr_time_index = i;
+
+            CRITICAL
+            {
+                curr_time_left_ms = (uint32_t)hours * 3600ul * 1000ul;
+                curr_time_left_ms += 100; // to show proper time in menu like 06:00
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void actionSaveProfile()
+{
+    eeprom.start_temp_index = curr_temp_index;
+    eeprom.start_time_index = curr_time_index;
+    storeToEeprom();
+}
+
+void actionGetProfile(uint8_t *temp, uint8_t *hours, bool *start_on)
+{
+    *temp     = temp_values[eeprom.start_temp_index];
+    *hours    = time_values[eeprom.start_time_index];
+    *start_on = eeprom.start_power_state;
+}
+
+void actionToggleStartPower()
+{
+    eeprom.start_power_state = !eeprom.start_power_state;
+    storeToEeprom();
+}
+
+void actionToggleBeeper()
+{
+    eeprom.use_beeper = !eeprom.use_beeper;
+    storeToEeprom();
+
+    if (eeprom.use_beeper)
+    {
+        beep(BEEP_LONG_TIME_MS);
+    }
+}
+
+bool actionSetHeaterWatts(uint16_t watts)
+{
+    if (0 == watts)
+    {
+        return false;
+    }
+
+    eeprom.heater_watts = watts;
+    storeToEeprom();
+
+    return true;
+}
+
+uint16_t actionGetHeaterWatts()
+{
+    return eeprom.heater_watts;
+}
+
+void actionGetStatus(SDryerStatus *status)
+{
+    uint32_t time_left_ms;
+
+    CRITICAL
+    {
+        time_left_ms = curr_time_left_ms;
+    }
+
+    status->on            = curr_on_off_state;
+    status->setpoint      = temp_values[curr_temp_index];
+    status->time_left_min = time_left_ms / 60000ul;
+    status->temperature   = curr_temperature;
+    status->humidity      = curr_humidity;
+    status->heater_temp   = curr_heater_temp;
+    status->heater_on     = heater_state;
+    status->faults        = fault_flags;
+}
+
+/************************************************************************************************
+ * STARTUP:
+ ************************************************************************************************/
+
+// Resumes the interrupted session or starts a new one if configured. A unit which has failed
+// POST stays off
+void startSession()
+{
+    if (FAULT_NONE != getLatchedFault())
+    {
+        switchPowerOff();
+    }
+    else if (resumeCheckpoint())
+    {
+        beep(BEEP_LONG_TIME_MS);
+    }
+    else if (eeprom.start_power_state)
     {
         beep(BEEP_LONG_TIME_MS);
         switchPowerOn();
@@ -659,22 +1271,260 @@ void main(void)
     {
         switchPowerOff();
     }
+}
+
+#define SENSOR_POWER_UP_MS   40 // AHT20 start up time after power on
+#define SENSOR_INIT_ATTEMPTS 10
+
+uint8_t sensor_init_attempts = 0;
+
+// Brings the sensor up, one attempt per call, then runs POST and starts the session, so the
+// display and keys work during all of it. Returns true once, when the session has started
+bool handleStartup()
+{
+    if (boot_complete)
+    {
+        return false;
+    }
 
-    // Perform up to 10 attempts to initialize sensor
-    uint8_t count = 10;
-    while (!initAHT20(GPIO_I2C_SCL, GPIO_I2C_SDA))
+    if (SENSOR_INIT_ATTEMPTS > sensor_init_attempts)
     {
-        if (0 != count)
+        if (SENSOR_POWER_UP_MS > getMillis())
         {
-            count--;
+            return false;
         }
-        else
+
+        if (initAHT20(GPIO_I2C_SCL, GPIO_I2C_SDA))
+        {
+            sensor_init_attempts = SENSOR_INIT_ATTEMPTS;
+        }
+        else if (SENSOR_INIT_ATTEMPTS == ++sensor_init_attempts)
         {
-            // Panic
-            while (1);
+            // the main loop keeps retrying the reads
+            raiseFault(FAULT_SENSOR_LOST);
         }
+
+        if (SENSOR_INIT_ATTEMPTS == sensor_init_attempts)
+        {
+            startPOST(GPIO_HEATER, GPIO_FAN);
+        }
+        return false;
+    }
+
+    if (!handlePOST())
+    {
+        return false;
+    }
+
+    boot_complete = true;
+    startSession();
+    return true;
+}
+
+// Sends boot_first_frame_us, boot_control_us and the reset cause once the control is active
+void reportBootTimes()
+{
+#if defined(USE_UART1) && !defined(USE_MODBUS)
+    uint8_t payload[9];
+
+    // little-endian as the rest of the protocol
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        payload[i]     = (uint8_t)(boot_first_frame_us >> (8 * i));
+        payload[4 + i] = (uint8_t)(boot_control_us     >> (8 * i));
+    }
+    payload[8] = getResetCause();
+
+    sendFrame(FRAME_BOOT, payload, sizeof(payload));
+#endif
+}
+
+/************************************************************************************************
+ * SAFETY:
+ ************************************************************************************************/
+
+uint8_t sensor_failures       = 0; // consecutive failed AHT20 reads
+EFault  reported_safety_fault = FAULT_NONE;
+
+// The tick latches safety faults and forces the outputs off, here they are raised like any other.
+// A safe stop fault ends the session
+void handleFaults()
+{
+    EFault safety_fault = getSafetyFault();
+
+    if (reported_safety_fault != safety_fault)
+    {
+        reported_safety_fault = safety_fault;
+        raiseFault(safety_fault);
+    }
+
+    if ((0 != getOutputErrors()) && (0 == (fault_flags & FAULT_FLAG_OUTPUT)))
+    {
+        raiseFault(FAULT_OUTPUT_READBACK);
     }
 
+    if ((FAULT_NONE != getLatchedFault()) && curr_on_off_state)
+    {
+        switchPowerOff();
+    }
+}
+
+/************************************************************************************************
+ * MODBUS:
+ ************************************************************************************************/
+
+#ifdef USE_MODBUS
+
+// Values without a variable of their own, refreshed before every handleModbus()
+uint8_t modbus_setpoint   = 0;
+uint8_t modbus_time_hours = 0;
+
+bool writeModbusSetpoint(uint16_t value)
+{
+    return (0xFF >= value) && actionSetSetpoint(value);
+}
+
+bool writeModbusTime(uint16_t value)
+{
+    return (0xFF >= value) && actionSetTime(value);
+}
+
+bool writeModbusRun(uint16_t value)
+{
+    if (1 < value)
+    {
+        return false;
+    }
+
+    if (value)
+    {
+        actionStart();
+    }
+    else
+    {
+        actionStop();
+    }
+
+    return true;
+}
+
+bool writeModbusAddress(uint16_t value)
+{
+    // 248..255 are reserved by the standard
+    if ((0 == value) || (247 < value))
+    {
+        return false;
+    }
+
+    // the response to this request is still sent from the old address
+    eeprom.modbus_address = value;
+    storeToEeprom();
+
+    return true;
+}
+
+// Register address is the index
+const SModbusRegister modbus_inputs[] =
+{
+    {&curr_temperature,              MODBUS_U8,       0},
+    {&curr_humidity,                 MODBUS_U8,       0},
+    {&curr_heater_temp,              MODBUS_S8,       0},
+    {&heater_state,                  MODBUS_U8,       0},
+    {&curr_time_left_ms,             MODBUS_U32_HIGH, 0},
+    {&curr_time_left_ms,             MODBUS_U32_LOW,  0},
+    {&fault_flags,                   MODBUS_U8,       0},
+    {&lifetime_stats.heater_on_s,    MODBUS_U32_HIGH, 0},
+    {&lifetime_stats.heater_on_s,    MODBUS_U32_LOW,  0},
+    {&lifetime_stats.energy_wh,      MODBUS_U32_HIGH, 0},
+    {&lifetime_stats.energy_wh,      MODBUS_U32_LOW,  0},
+    {&lifetime_stats.sessions,       MODBUS_U16,      0},
+    {&lifetime_stats.heater_cycles,  MODBUS_U32_HIGH, 0},
+    {&lifetime_stats.heater_cycles,  MODBUS_U32_LOW,  0},
+    {&boot_first_frame_us,           MODBUS_U32_HIGH, 0},
+    {&boot_first_frame_us,           MODBUS_U32_LOW,  0},
+    {&boot_control_us,               MODBUS_U32_HIGH, 0},
+    {&boot_control_us,               MODBUS_U32_LOW,  0},
+};
+
+const SModbusRegister modbus_holdings[] =
+{
+    {&modbus_setpoint,               MODBUS_U8,       writeModbusSetpoint},
+    {&modbus_time_hours,             MODBUS_U8,       writeModbusTime},
+    {&curr_on_off_state,             MODBUS_U8,       writeModbusRun},
+    {&eeprom.heater_watts,           MODBUS_U16,      actionSetHeaterWatts},
+    {&eeprom.modbus_address,         MODBUS_U8,       writeModbusAddress},
+};
+
+void initModbusSlave()
+{
+    initUART(MODBUS_BAUDRATE);
+    initModbus(eeprom.modbus_address,
+               modbus_inputs,   sizeof(modbus_inputs)/sizeof(SModbusRegister),
+               modbus_holdings, sizeof(modbus_holdings)/sizeof(SModbusRegister));
+}
+
+void handleModbusSlave()
+{
+    modbus_setpoint   = temp_values[curr_temp_index];
+    modbus_time_hours = time_values[curr_time_index];
+
+    handleModbus();
+
+    setModbusAddress(eeprom.modbus_address);
+}
+
+#endif
+
+/************************************************************************************************
+ * MAIN:
+ ************************************************************************************************/
+
+void main(void)
+{
+    /* Initialization of the clock */
+    initClock();
+
+    initOutput(GPIO_HEATER, 0);
+    initOutput(GPIO_FAN,    0);
+    initOutput(GPIO_BEEPER, 0);
+
+    // heater without airflow overheats the chamber
+    setOutputInterlock(GPIO_HEATER, GPIO_FAN);
+
+    // display and keys first, everything else comes up behind the splash
+    const uint8_t keys_count = sizeof(keys)/sizeof(SKeyHandler);
+    initKeys(keys_count);
+    initKeyChords(key_chords, sizeof(key_chords)/sizeof(SKeyChord));
+
+    // boot timing counts from here
+    initTimer2();
+    enableInterrupts();
+
+    initTM1621C(GPIO_DISP_CS, GPIO_DISP_WR, GPIO_DISP_DATA, GPIO_BACKLIGHT);
+    setBacklightState(false);
+
+    updateView();
+    boot_first_frame_us = getMicros();
+
+    readFromEeprom();
+    initStats();
+    initFaults();
+    initWatchdog();
+
+    if (RESET_WATCHDOG == getResetCause())
+    {
+        raiseFault(FAULT_WATCHDOG_RESET);
+    }
+
+#if defined(USE_MODBUS)
+    initModbusSlave();
+#elif defined(USE_UART1)
+    initUART(PROTOCOL_BAUDRATE);
+    initCommands();
+#endif
+
+    initNTC(GPIO_TEMP_SENSOR);
+
     uint32_t timer_1s = millis + 1000;
 
     while (1)
@@ -683,18 +1533,35 @@ void main(void)
         {
             timer_1s = millis + 1000;
 
-            if (!readAHT20(&curr_temperature, &curr_humidity))
+            beginClockBurst();
+
+            curr_heater_temp = getHeaterTemperature();
+
+            // the sensor is brought up by handleStartup()
+            if (boot_complete)
             {
-                switchHeater(false);
-                while(1) ;
+                if (readAHT20(&curr_temperature, &curr_humidity))
+                {
+                    sensor_failures = 0;
+                    setSafetyReadings(curr_heater_temp, curr_temperature);
+                }
+                else if (FAULT_SENSOR_RETRIES == ++sensor_failures)
+                {
+                    raiseFault(FAULT_SENSOR_LOST);
+                }
             }
 
-            int8_t heater_temp     = getHeaterTemperature();
+            // a failed read is retried next second, the task is still alive
+            checkInWatchdog(WATCHDOG_TASK_SENSOR);
+
+            handleFaults();
+
             uint8_t requested_temp = temp_values[curr_temp_index];
 
             if (curr_on_off_state)
             {
-                if ((curr_temperature < requested_temp) && (heater_temp < (requested_temp + 40)))
+                if ((0 == sensor_failures) &&
+                    (curr_temperature < requested_temp) && (curr_heater_temp < (requested_temp + 40)))
                 {
                     switchHeater(true);
                 }
@@ -703,14 +1570,75 @@ void main(void)
                     switchHeater(false);
                 }
             }
+
+            checkInWatchdog(WATCHDOG_TASK_CONTROL);
+
+            if (boot_complete && (0 == boot_control_us))
+            {
+                boot_control_us = getMicros();
+                reportBootTimes();
+            }
+
+            if (curr_on_off_state)
+            {
+                int8_t history_sample[HISTORY_CHANNELS] = {curr_temperature, curr_humidity, curr_heater_temp};
+
+                addHistorySample(history_sample);
+                handleStatsSecond(heater_state, eeprom.heater_watts);
+            }
+            else if (checkpoint_active)
+            {
+                // session has just ended, the checkpoint below stores it
+                storeStats();
+            }
+
+            if (session_completed)
+            {
+                session_completed = false;
+                countSession();
+            }
+
+            handleCheckpoint();
+
+#if defined(USE_UART1) && !defined(USE_MODBUS)
+            STelemetrySample sample;
+
+            sample.temperature = curr_temperature;
+            sample.humidity    = curr_humidity;
+            sample.heater_temp = curr_heater_temp;
+            sample.heater_on   = heater_state;
+            sample.fan_on      = getOutput(GPIO_FAN);
+            sample.setpoint    = requested_temp;
+            sample.faults      = fault_flags;
+
+            handleTelemetrySecond(millis, &sample);
+#endif
+        }
+
+        // the first control pass runs right after the session has started
+        if (handleStartup())
+        {
+            timer_1s = millis;
         }
 
+        handleStatsPageTimeout();
+
         EKeyId    new_key_id    = 1;
         EKeyEvent new_key_event = 12;
 
-        if (getKeyState(&new_key_id, &new_key_event))
+        // UP repeats while it steps menu values, otherwise its long press toggles the beeper
+        setKeyFlags(KEY_UP, (curr_on_off_state && (MENU_WORK != curr_menu_state)) ? KEY_FLAG_REPEAT : 0);
+
+        // keys wait in the queue until the session has started
+        if (boot_complete && getKeyState(&new_key_id, &new_key_event))
         {
-            if (KEY_PRESSED == new_key_event)
+            wakeBacklight();
+
+            if (STATS_PAGE_NONE != stats_page)
+            {
+                handleStatsPageKey(new_key_id, new_key_event);
+            }
+            else if (KEY_PRESSED == new_key_event)
             {
                 beep(BEEP_SHORT_TIME_MS);
 
@@ -734,6 +1662,11 @@ void main(void)
 
                 handleStateOnOff(new_key_id);
             }
+            else if (KEY_REPEATED == new_key_event)
+            {
+                setLedState(new_key_id, 1);
+                handleStateOnOff(new_key_id);
+            }
             else if (KEY_LONG_PRESSED == new_key_event)
             {
                 beep(BEEP_LONG_TIME_MS);
@@ -741,24 +1674,19 @@ void main(void)
                 switch (new_key_id)
                 {
                     case KEY_POWER:
-                        eeprom.start_power_state = !eeprom.start_power_state;
-                        storeToEeprom();
+                        actionToggleStartPower();
                         break;
 
                     case KEY_MODE:
-                        eeprom.start_temp_index = curr_temp_index;
-                        eeprom.start_time_index = curr_time_index;
-                        storeToEeprom();
+                        actionSaveProfile();
                         break;
 
                     case KEY_UP:
-                        eeprom.use_beeper = !eeprom.use_beeper;
-                        storeToEeprom();
+                        actionToggleBeeper();
+                        break;
 
-                        if (eeprom.use_beeper)
-                        {
-                            beep(BEEP_LONG_TIME_MS);
-                        }
+                    case KEY_POWER_MODE:
+                        openStatsPage(STATS_PAGE_HOURS);
                         break;
 
                     default:
@@ -772,16 +1700,25 @@ void main(void)
         }
         else
         {
-            if (curr_on_off_state && (MENU_WORK == curr_menu_state))
-            {
-                showWorkScreen();
-            }
-
             setLedState(KEY_POWER, 0);
             setLedState(KEY_MODE,  0);
             setLedState(KEY_UP,    0);
         }
 
+        checkInWatchdog(WATCHDOG_TASK_KEYS);
+
+#if defined(USE_MODBUS)
+        handleModbusSlave();
+#elif defined(USE_UART1)
+        handleCommands();
+#endif
+
+        handleBacklight();
+        updateView();
+        handleDisp();
+        checkInWatchdog(WATCHDOG_TASK_DISPLAY);
+
+        endClockBurst();
         delayMs(20);
     }
 }
@@ -793,17 +1730,30 @@ void delayMs(uint16_t ms)
 
     while (millis != wait_until)
     {
-        // do nothing, just wait
+        wfi(); // sleep until the next interrupt, at least the 1 ms tick
     }
 }
 
-void fatal(uint8_t err)
+uint32_t getMillis()
 {
-    switchHeater(false);
+    uint32_t result;
+
+    CRITICAL
+    {
+        result = millis;
+    }
+
+    return result;
+}
 
-    printErr(err);
+// Forces the heater off and stops checking in, so the watchdog resets the MCU
+void haltSafe()
+{
+    setOutputsSafeState(true);
 
-    delayMs(5000);
+    while (1)
+    {
+    }
 }
 
 #ifdef USE_FULL_ASSERT
@@ -820,9 +1770,6 @@ void assert_failed(uint8_t* file, uint32_t line)
     /* User can add his own implementation to report the file name and line number,
         ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
 
-    /* Infinite loop */
-    while (1)
-    {
-    }
+    haltSafe();
 }
 #endif
@@ -0,0 +1,271 @@
+/************************************************************************************************
+ * Modbus RTU slave:
+ ************************************************************************************************/
+
+#include <modbus.h>
+#include <uart.h>
+#include <crc16.h>
+#include <utilities.h>
+
+#define MODBUS_READ_HOLDING   0x03
+#define MODBUS_READ_INPUT     0x04
+#define MODBUS_WRITE_SINGLE   0x06
+#define MODBUS_WRITE_MULTIPLE 0x10
+
+#define MODBUS_ILLEGAL_FUNCTION 0x01
+#define MODBUS_ILLEGAL_ADDRESS  0x02
+#define MODBUS_ILLEGAL_VALUE    0x03
+
+const SModbusRegister* modbus_inputs         = 0;
+uint8_t                modbus_inputs_count   = 0;
+const SModbusRegister* modbus_holdings       = 0;
+uint8_t                modbus_holdings_count = 0;
+uint8_t                modbus_address        = 1;
+
+uint8_t                modbus_frame[MODBUS_FRAME_MAX];
+volatile uint8_t       modbus_frame_size     = 0;
+volatile bool          modbus_frame_ready    = false; // set by the gap timer, cleared by the main loop
+volatile bool          modbus_overflow       = false;
+
+// private:
+uint16_t readRegister(const SModbusRegister *reg)
+{
+    uint16_t result = 0;
+
+    // values may be changed by interrupts
+    CRITICAL
+    {
+        switch (reg->type)
+        {
+            case MODBUS_U8:       result = *(const volatile uint8_t*)reg->value;                    break;
+            case MODBUS_S8:       result = (int16_t)*(const volatile int8_t*)reg->value;            break;
+            case MODBUS_U16:      result = *(const volatile uint16_t*)reg->value;                   break;
+            case MODBUS_U32_HIGH: result = (uint16_t)(*(const volatile uint32_t*)reg->value >> 16); break;
+            default:              result = (uint16_t)*(const volatile uint32_t*)reg->value;         break;
+        }
+    }
+
+    return result;
+}
+
+// private:
+uint16_t getU16(const uint8_t *data)
+{
+    return ((uint16_t)data[0] << 8) | data[1];
+}
+
+// private:
+// Returns size of the response or 0x80 | exception code
+uint8_t readRegisters(const SModbusRegister *table, uint8_t count, uint8_t *response)
+{
+    uint16_t first    = getU16(&modbus_frame[2]);
+    uint16_t quantity = getU16(&modbus_frame[4]);
+
+    if ((8 != modbus_frame_size) || (0 == quantity) || (MODBUS_READ_MAX < quantity))
+    {
+        return 0x80 | MODBUS_ILLEGAL_VALUE;
+    }
+
+    // int is 16 bits on the target, first + quantity could wrap
+    if ((first >= count) || (quantity > count - first))
+    {
+        return 0x80 | MODBUS_ILLEGAL_ADDRESS;
+    }
+
+    response[2] = quantity * 2;
+
+    for (uint8_t i = 0; i < quantity; i++)
+    {
+        uint16_t value = readRegister(&table[first + i]);
+
+        response[3 + 2 * i] = value >> 8;
+        response[4 + 2 * i] = (uint8_t)value;
+    }
+
+    return 3 + quantity * 2;
+}
+
+// private:
+uint8_t writeRegisters(uint16_t first, uint16_t quantity, const uint8_t *values)
+{
+    if ((first >= modbus_holdings_count) || (quantity > modbus_holdings_count - first))
+    {
+        return 0x80 | MODBUS_ILLEGAL_ADDRESS;
+    }
+
+    for (uint8_t i = 0; i < quantity; i++)
+    {
+        if (0 == modbus_holdings[first + i].write)
+        {
+            return 0x80 | MODBUS_ILLEGAL_ADDRESS;
+        }
+    }
+
+    for (uint8_t i = 0; i < quantity; i++)
+    {
+        if (!modbus_holdings[first + i].write(getU16(&values[2 * i])))
+        {
+            return 0x80 | MODBUS_ILLEGAL_VALUE;
+        }
+    }
+
+    return 0;
+}
+
+// private:
+uint8_t processFrame(uint8_t *response)
+{
+    uint8_t result;
+
+    switch (modbus_frame[1])
+    {
+        case MODBUS_READ_HOLDING:
+            return readRegisters(modbus_holdings, modbus_holdings_count, response);
+
+        case MODBUS_READ_INPUT:
+            return readRegisters(modbus_inputs, modbus_inputs_count, response);
+
+        case MODBUS_WRITE_SINGLE:
+            if (8 != modbus_frame_size)
+            {
+                return 0x80 | MODBUS_ILLEGAL_VALUE;
+            }
+
+            result = writeRegisters(getU16(&modbus_frame[2]), 1, &modbus_frame[4]);
+            break;
+
+        case MODBUS_WRITE_MULTIPLE:
+        {
+            uint16_t quantity = getU16(&modbus_frame[4]);
+
+            if ((0 == quantity) || (modbus_frame[6] != (quantity * 2)) ||
+                (modbus_frame_size != (9 + quantity * 2)))
+            {
+                return 0x80 | MODBUS_ILLEGAL_VALUE;
+            }
+
+            result = writeRegisters(getU16(&modbus_frame[2]), quantity, &modbus_frame[7]);
+            break;
+        }
+
+        default:
+            return 0x80 | MODBUS_ILLEGAL_FUNCTION;
+    }
+
+    if (0 != result)
+    {
+        return result;
+    }
+
+    // writes echo address and value / quantity
+    for (uint8_t i = 2; i < 6; i++)
+    {
+        response[i] = modbus_frame[i];
+    }
+
+    return 6;
+}
+
+// public:
+void initModbus(uint8_t address,
+                const SModbusRegister *inputs,   uint8_t inputs_count,
+                const SModbusRegister *holdings, uint8_t holdings_count)
+{
+    modbus_address        = address;
+    modbus_inputs         = inputs;
+    modbus_inputs_count   = inputs_count;
+    modbus_holdings       = holdings;
+    modbus_holdings_count = holdings_count;
+
+    setUARTReceiver(receiveModbusByte);
+    setUARTGapHandler(endModbusFrame, MODBUS_T35_US);
+}
+
+// public:
+void setModbusAddress(uint8_t address)
+{
+    modbus_address = address;
+}
+
+// public:
+void receiveModbusByte(uint8_t data)
+{
+    // the previous frame is still being processed
+    if (modbus_frame_ready)
+    {
+        return;
+    }
+
+    if (MODBUS_FRAME_MAX == modbus_frame_size)
+    {
+        modbus_overflow = true;
+        return;
+    }
+
+    modbus_frame[modbus_frame_size++] = data;
+}
+
+// public:
+void endModbusFrame()
+{
+    if (modbus_frame_ready)
+    {
+        return;
+    }
+
+    if (modbus_overflow || (4 > modbus_frame_size))
+    {
+        modbus_overflow   = false;
+        modbus_frame_size = 0;
+        return;
+    }
+
+    modbus_frame_ready = true;
+}
+
+// public:
+void handleModbus()
+{
+    uint8_t response[3 + 2 * MODBUS_READ_MAX + 2];
+
+    if (!modbus_frame_ready)
+    {
+        return;
+    }
+
+    uint8_t  address = modbus_frame[0];
+    uint16_t crc     = calcCRC16(modbus_frame, modbus_frame_size - 2);
+    bool     valid   = ((uint8_t)crc == modbus_frame[modbus_frame_size - 2]) &&
+                       ((uint8_t)(crc >> 8) == modbus_frame[modbus_frame_size - 1]);
+
+    if (valid && ((modbus_address == address) || (0 == address)))
+    {
+        uint8_t size = processFrame(response);
+
+        if (size & 0x80)
+        {
+            response[1] = modbus_frame[1] | 0x80;
+            response[2] = size & 0x7F;
+            size = 3;
+        }
+        else
+        {
+            response[1] = modbus_frame[1];
+        }
+
+        response[0] = modbus_address;
+
+        crc = calcCRC16(response, size);
+        response[size++] = (uint8_t)crc;
+        response[size++] = (uint8_t)(crc >> 8);
+
+        // broadcasts are never answered
+        if (0 != address)
+        {
+            writeUART(response, size);
+        }
+    }
+
+    modbus_frame_size  = 0;
+    modbus_frame_ready = false;
+}
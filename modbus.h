@@ -0,0 +1,53 @@
+/************************************************************************************************
+ * Modbus RTU slave:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Frames are collected by the UART RX interrupt and ended by 3.5 characters of silence, timed by
+// the UART gap timer. The frame is processed in the main loop, so polling never runs in interrupt
+// context. Registers are read in place from the variables they point to.
+//
+// Supported functions: 03 read holding, 04 read input, 06 write single, 16 write multiple
+// registers. Address 0 is broadcast: writes are executed and nothing is answered.
+
+#define MODBUS_BAUDRATE      19200
+// 3.5 characters of 11 bits
+#define MODBUS_T35_US        (35ul * 11ul * 100000ul / MODBUS_BAUDRATE)
+#define MODBUS_FRAME_MAX     40
+#define MODBUS_READ_MAX      24 // registers per read, the response must fit the UART TX buffer
+
+typedef enum
+{
+    MODBUS_U8,
+    MODBUS_S8,
+    MODBUS_U16,
+    MODBUS_U32_HIGH, // upper half of a 32-bit value
+    MODBUS_U32_LOW,
+} EModbusType;
+
+typedef struct
+{
+    const volatile void *value;
+    uint8_t              type;  // EModbusType
+    bool               (*write)(uint16_t value); // 0 - read only. False - illegal value
+} SModbusRegister;
+
+// Register address is the index in the table
+void initModbus(uint8_t address,
+                const SModbusRegister *inputs,   uint8_t inputs_count,
+                const SModbusRegister *holdings, uint8_t holdings_count);
+
+void setModbusAddress(uint8_t address);
+
+// Called from the UART RX interrupt
+void receiveModbusByte(uint8_t data);
+
+// Called from the UART gap timer interrupt
+void endModbusFrame();
+
+// Processes a received frame and queues the response. Must be called from the main loop
+void handleModbus();
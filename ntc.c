@@ -0,0 +1,83 @@
+/************************************************************************************************
+ * Heater NTC:
+ ************************************************************************************************/
+
+#include <ntc.h>
+
+#include <stm8s_adc1.h>
+
+typedef struct
+{
+    int32_t res;
+    uint8_t temp;
+} SResToTemp;
+
+const SResToTemp res2temp[] =
+{
+    {383647l, 0},   // 0
+    {287573l, 5},   // 1
+    {217764l, 10},  // 2
+    {166500l, 15},  // 3
+    {128475l, 20},  // 4
+    {99500l,  25},  // 5
+    {75530l,  30},  // 6
+    {46050l,  40},  // 7
+    {31070l,  50},  // 8
+    {20800l , 60},  // 9
+    {14490l,  70},  // 10
+    {10000l,  80},  // 11
+    {7160l,   90},  // 12
+    {5220l,   100}, // 13
+    {3860l,   110}, // 14
+    {3316l,   120}, // 15
+    {2873l,   125}, // 16
+};
+
+// public:
+void initNTC(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin)
+{
+    /*  Init GPIO for ADC1 */
+    GPIO_Init(port, pin, GPIO_MODE_IN_FL_NO_IT);
+
+    /* Init ADC1 peripheral */
+    ADC1_Init(ADC1_CONVERSIONMODE_CONTINUOUS,
+              ADC1_CHANNEL_2,
+              ADC1_PRESSEL_FCPU_D2,
+              ADC1_EXTTRIG_TIM,
+              DISABLE,
+              ADC1_ALIGN_RIGHT,
+              ADC1_SCHMITTTRIG_CHANNEL2,
+              DISABLE);
+
+    /*Start Conversion */
+    ADC1_StartConversion();
+}
+
+// public:
+uint16_t readNTCRaw()
+{
+    return ADC1_GetConversionValue();
+}
+
+// public:
+bool convertNTC(uint16_t raw, int8_t *temp)
+{
+    int32_t v   = ((int32_t)raw * 3300l) / 1024l;
+    int32_t res = 100000l * v / (3300l - v);
+
+    for (uint8_t i = 0; i < ((sizeof(res2temp) / sizeof(SResToTemp)) - 1); i++)
+    {
+        if ((res2temp[i].res > res) && (res2temp[i+1].res <= res))
+        {
+            int32_t dR1  = res2temp[i+1].res  - res2temp[i].res;
+            int32_t dT1  = res2temp[i+1].temp - res2temp[i].temp;
+            int32_t dR2  = res - res2temp[i].res;
+            int32_t dT2  = dT1 * dR2 / dR1;
+
+            *temp = res2temp[i].temp + dT2;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,25 @@
+/************************************************************************************************
+ * Heater NTC:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stm8s.h>
+
+// 100k NTC to ground with 100k pull-up to 3.3 V, measured by ADC1 channel 2 in continuous mode.
+// Hotter NTC - lower reading.
+
+// Raw readings beyond these can only be a broken circuit
+#define NTC_ADC_OPEN  1015
+#define NTC_ADC_SHORT 8
+
+void initNTC(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin);
+
+// Last conversion, 10 bits
+uint16_t readNTCRaw();
+
+// False if raw is outside of the table (0..125 degC), temp is not changed then
+bool convertNTC(uint16_t raw, int8_t *temp);
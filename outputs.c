@@ -0,0 +1,203 @@
+/************************************************************************************************
+ * Outputs:
+ ************************************************************************************************/
+
+#include <outputs.h>
+#include <utilities.h>
+
+typedef struct
+{
+    GPIO_TypeDef* port;
+    uint8_t       mask;      // managed pins
+    uint8_t       shadow;    // requested state
+    uint8_t       committed; // state written by the last commit
+} SOutputPort;
+
+typedef struct
+{
+    SOutputPort* port;
+    uint8_t      pin;
+    SOutputPort* required_port;
+    uint8_t      required_pin;
+} SOutputInterlock;
+
+SOutputPort      output_ports[OUTPUT_PORTS_MAX];
+uint8_t          output_ports_count = 0;
+
+SOutputInterlock output_interlocks[OUTPUT_INTERLOCKS_MAX];
+uint8_t          output_interlocks_count = 0;
+
+volatile bool    outputs_safe_state = false;
+volatile uint8_t output_errors      = 0;
+
+// private:
+SOutputPort* findOutputPort(GPIO_TypeDef* port)
+{
+    for (uint8_t i = 0; i < output_ports_count; i++)
+    {
+        if (port == output_ports[i].port)
+        {
+            return &output_ports[i];
+        }
+    }
+
+    return 0;
+}
+
+// public:
+void initOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin, bool state)
+{
+    SOutputPort *this = findOutputPort(port);
+
+    if ((0 == this) && (OUTPUT_PORTS_MAX > output_ports_count))
+    {
+        this = &output_ports[output_ports_count];
+
+        this->port      = port;
+        this->mask      = 0;
+        this->shadow    = 0;
+        this->committed = 0;
+
+        output_ports_count++;
+    }
+
+    if (0 == this)
+    {
+        return;
+    }
+
+    GPIO_Init(port, pin, state ? GPIO_MODE_OUT_PP_HIGH_FAST : GPIO_MODE_OUT_PP_LOW_FAST);
+
+    CRITICAL
+    {
+        this->mask |= pin;
+
+        if (state)
+        {
+            this->shadow    |= pin;
+            this->committed |= pin;
+        }
+        else
+        {
+            this->shadow    &= (uint8_t)~pin;
+            this->committed &= (uint8_t)~pin;
+        }
+    }
+}
+
+// public:
+void setOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin, bool state)
+{
+    SOutputPort *this = findOutputPort(port);
+
+    if (0 == this)
+    {
+        return;
+    }
+
+    // shadow is shared with the tick interrupt
+    CRITICAL
+    {
+        if (state)
+        {
+            this->shadow |= pin;
+        }
+        else
+        {
+            this->shadow &= (uint8_t)~pin;
+        }
+    }
+}
+
+// public:
+bool getOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin)
+{
+    SOutputPort *this = findOutputPort(port);
+
+    return (0 != this) && (0 != (this->shadow & pin));
+}
+
+// public:
+void setOutputInterlock(GPIO_TypeDef* port,          GPIO_Pin_TypeDef pin,
+                        GPIO_TypeDef* required_port, GPIO_Pin_TypeDef required_pin)
+{
+    if (OUTPUT_INTERLOCKS_MAX == output_interlocks_count)
+    {
+        return;
+    }
+
+    SOutputInterlock *this = &output_interlocks[output_interlocks_count];
+
+    this->port          = findOutputPort(port);
+    this->pin           = pin;
+    this->required_port = findOutputPort(required_port);
+    this->required_pin  = required_pin;
+
+    if ((0 != this->port) && (0 != this->required_port))
+    {
+        output_interlocks_count++;
+    }
+}
+
+// public:
+void setOutputsSafeState(bool safe)
+{
+    outputs_safe_state = safe;
+}
+
+// public:
+uint8_t getOutputErrors()
+{
+    return output_errors;
+}
+
+// private:
+// Returns shadow state of the port with interlocks applied
+uint8_t getAllowedOutputs(SOutputPort *this)
+{
+    uint8_t state = this->shadow;
+
+    for (uint8_t i = 0; i < output_interlocks_count; i++)
+    {
+        SOutputInterlock *interlock = &output_interlocks[i];
+
+        if (this != interlock->port)
+        {
+            continue;
+        }
+
+        if (outputs_safe_state || (0 == (interlock->required_port->shadow & interlock->required_pin)))
+        {
+            state &= (uint8_t)~interlock->pin;
+        }
+    }
+
+    return state;
+}
+
+// public:
+void handleOutputsTick()
+{
+    for (uint8_t i = 0; i < output_ports_count; i++)
+    {
+        SOutputPort *this = &output_ports[i];
+
+        // pins committed a tick ago have settled by now
+        if (0 != ((this->port->IDR ^ this->committed) & this->mask))
+        {
+            if (0xFF != output_errors)
+            {
+                output_errors++;
+            }
+        }
+
+        uint8_t state = getAllowedOutputs(this) & this->mask;
+
+        // ODR is rewritten also if a read-modify-write elsewhere has lost managed bits
+        if ((state != this->committed) || (state != (this->port->ODR & this->mask)))
+        {
+            this->port->ODR = (this->port->ODR & (uint8_t)~this->mask) | state;
+            this->committed = state;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+/************************************************************************************************
+ * Outputs:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stm8s.h>
+
+// Modules change bits of a per port shadow byte only. handleOutputsTick() writes each port whose
+// managed bits differ from the shadow with one ODR access and verifies pin levels by IDR readback.
+
+#define OUTPUT_PORTS_MAX      4
+#define OUTPUT_INTERLOCKS_MAX 2
+
+// Configures pin as push-pull output managed by the shadow registers
+void initOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin, bool state);
+
+void setOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin, bool state);
+
+bool getOutput(GPIO_TypeDef* port, GPIO_Pin_TypeDef pin);
+
+// Output may be high only while the required output is requested high
+void setOutputInterlock(GPIO_TypeDef* port,          GPIO_Pin_TypeDef pin,
+                        GPIO_TypeDef* required_port, GPIO_Pin_TypeDef required_pin);
+
+// Safe state forces all interlocked outputs low regardless of their shadow state
+void setOutputsSafeState(bool safe);
+
+// Count of readback mismatches: pin level differs from the level committed a tick before
+uint8_t getOutputErrors();
+
+// Must be called every 1 ms
+void handleOutputsTick();
@@ -0,0 +1,249 @@
+/************************************************************************************************
+ * Power-on self-test:
+ ************************************************************************************************/
+
+#include <post.h>
+#include <ntc.h>
+#include <aht20.h>
+#include <journal.h>
+#include <outputs.h>
+#include <faults.h>
+#include <utilities.h>
+
+typedef enum
+{
+    POST_IDLE,
+    POST_CHECKS,
+    POST_BASELINE,
+    POST_PULSE,
+    POST_RESPONSE,
+    POST_DONE,
+} EPOSTState;
+
+EPOSTState       post_state       = POST_IDLE;
+bool             post_passed      = true;
+uint32_t         post_start_ms    = 0;
+uint16_t         post_raw_start   = 0;    // window average before the pulse
+uint32_t         post_sample_ms   = 0;
+uint16_t         post_raw_sum     = 0;
+uint8_t          post_raw_count   = 0;
+uint8_t          post_windows     = 0;    // windows in a row below the start by the minimal drop
+
+GPIO_TypeDef*    post_heater_port = 0;
+GPIO_Pin_TypeDef post_heater_pin  = 0;
+GPIO_TypeDef*    post_fan_port    = 0;
+GPIO_Pin_TypeDef post_fan_pin     = 0;
+
+// private:
+void failPOST(EFault fault)
+{
+    post_passed = false;
+    raiseFault(fault);
+}
+
+// private:
+// Returns true if the heater pulse can be judged by the NTC
+bool checkNTC()
+{
+    uint16_t raw = readNTCRaw();
+    int8_t   temp;
+
+    if (NTC_ADC_OPEN < raw)
+    {
+        failPOST(FAULT_POST_NTC_OPEN);
+        return false;
+    }
+
+    if (NTC_ADC_SHORT > raw)
+    {
+        failPOST(FAULT_POST_NTC_SHORT);
+        return false;
+    }
+
+    if (!convertNTC(raw, &temp))
+    {
+        failPOST(FAULT_NTC_RANGE);
+        return false;
+    }
+
+    return POST_PULSE_MAX_TEMP > temp;
+}
+
+// private:
+void checkSensor()
+{
+    uint8_t status;
+
+    if (!readAHT20Status(&status) || (0 == (status & AHT20_STATUS_CALIBRATED)) ||
+        (0 != (status & AHT20_STATUS_BUSY)))
+    {
+        failPOST(FAULT_POST_SENSOR);
+    }
+}
+
+// private:
+void checkEEPROM()
+{
+    if (POST_JOURNAL_CORRUPT_MAX < getJournalCorruptSlots())
+    {
+        failPOST(FAULT_POST_EEPROM);
+    }
+}
+
+// private:
+void startWindow()
+{
+    post_sample_ms = getMillis();
+    post_raw_sum   = 0;
+    post_raw_count = 0;
+}
+
+// private:
+// Takes one NTC reading every POST_SAMPLE_MS. Returns true when a window is complete
+bool sampleNTC(uint16_t *average)
+{
+    uint32_t now = getMillis();
+
+    if (POST_SAMPLE_MS > (now - post_sample_ms))
+    {
+        return false;
+    }
+
+    post_sample_ms  = now;
+    post_raw_sum   += readNTCRaw();
+    post_raw_count++;
+
+    if (POST_AVERAGE_SAMPLES > post_raw_count)
+    {
+        return false;
+    }
+
+    *average       = post_raw_sum / POST_AVERAGE_SAMPLES;
+    post_raw_sum   = 0;
+    post_raw_count = 0;
+    return true;
+}
+
+// private:
+void stopPulse()
+{
+    setOutput(post_heater_port, post_heater_pin, false);
+    setOutput(post_fan_port,    post_fan_pin,    false);
+}
+
+// public:
+void startPOST(GPIO_TypeDef* heater_port, GPIO_Pin_TypeDef heater_pin,
+               GPIO_TypeDef* fan_port,    GPIO_Pin_TypeDef fan_pin)
+{
+    post_heater_port = heater_port;
+    post_heater_pin  = heater_pin;
+    post_fan_port    = fan_port;
+    post_fan_pin     = fan_pin;
+
+    post_passed      = true;
+    post_state       = POST_CHECKS;
+}
+
+// public:
+bool handlePOST()
+{
+    uint32_t elapsed_ms = getMillis() - post_start_ms;
+
+    switch (post_state)
+    {
+        case POST_CHECKS:
+        {
+            bool pulse = checkNTC();
+
+            checkSensor();
+            checkEEPROM();
+
+            // a latched fault forces the heater off anyway
+            if (!pulse || (FAULT_NONE != getLatchedFault()))
+            {
+                post_state = POST_DONE;
+                break;
+            }
+
+            startWindow();
+            post_state = POST_BASELINE;
+            break;
+        }
+
+        case POST_BASELINE:
+            if (sampleNTC(&post_raw_start))
+            {
+                post_windows  = 0;
+                post_start_ms = getMillis();
+
+                setOutput(post_fan_port,    post_fan_pin,    true);
+                setOutput(post_heater_port, post_heater_pin, true);
+
+                post_state = POST_PULSE;
+            }
+            break;
+
+        case POST_PULSE:
+        case POST_RESPONSE:
+        {
+            uint16_t average;
+
+            // the reading falls as the NTC warms up
+            if (sampleNTC(&average))
+            {
+                if ((average < post_raw_start) && (POST_PULSE_MIN_ADC <= (post_raw_start - average)))
+                {
+                    post_windows++;
+                }
+                else
+                {
+                    post_windows = 0;
+                }
+            }
+
+            bool responded = POST_RESPONSE_WINDOWS <= post_windows;
+
+            if ((POST_PULSE == post_state) && !responded && (POST_PULSE_MS <= elapsed_ms))
+            {
+                setOutput(post_heater_port, post_heater_pin, false);
+                post_state = POST_RESPONSE;
+            }
+
+            // the pulse ends as soon as the NTC has responded
+            if (responded || (POST_RESPONSE_MS <= elapsed_ms))
+            {
+                stopPulse();
+
+                if (0 != getOutputErrors())
+                {
+                    failPOST(FAULT_OUTPUT_READBACK);
+                }
+
+                if (!responded)
+                {
+                    failPOST(FAULT_POST_HEATER);
+                }
+
+                post_state = POST_DONE;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return POST_DONE == post_state;
+}
+
+// public:
+bool isPOSTRunning()
+{
+    return (POST_IDLE != post_state) && (POST_DONE != post_state);
+}
+
+// public:
+bool isPOSTPassed()
+{
+    return post_passed;
+}
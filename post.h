@@ -0,0 +1,42 @@
+/************************************************************************************************
+ * Power-on self-test:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stm8s.h>
+
+// Stepped from the main loop, so the display and keys keep running. Takes POST_RESPONSE_MS and
+// one window at most. Every failed check raises its fault; the heater pulse is skipped if the
+// NTC is broken or already warm.
+//  - NTC: open / short circuit by the raw reading, then the table range
+//  - AHT20: answers at its address, calibrated, not stuck busy
+//  - EEPROM: at most POST_JOURNAL_CORRUPT_MAX corrupt journal slots
+//  - heater: with the fan on, a pulse of up to POST_PULSE_MS must lower the NTC reading by
+//    POST_PULSE_MIN_ADC within POST_RESPONSE_MS after the pulse start. Readings are averaged over
+//    windows of POST_AVERAGE_SAMPLES taken every POST_SAMPLE_MS, the drop is counted from the
+//    window before the pulse and must hold in POST_RESPONSE_WINDOWS windows in a row. The pulse
+//    ends as soon as it does. Fan and heater drive is verified by the output readback meanwhile
+
+#define POST_PULSE_MS            1000
+#define POST_RESPONSE_MS         1800
+#define POST_PULSE_MIN_ADC       3
+#define POST_SAMPLE_MS           20   // the main loop period, handlePOST() isn't called more often
+#define POST_AVERAGE_SAMPLES     4    // ~100 ms windows with the loop work
+#define POST_RESPONSE_WINDOWS    3    // ~300 ms, leaves ~1.5 s for the drop to start
+#define POST_PULSE_MAX_TEMP      50
+#define POST_JOURNAL_CORRUPT_MAX 2
+
+void startPOST(GPIO_TypeDef* heater_port, GPIO_Pin_TypeDef heater_pin,
+               GPIO_TypeDef* fan_port,    GPIO_Pin_TypeDef fan_pin);
+
+// Must be called from the main loop. Returns true once POST is finished
+bool handlePOST();
+
+bool isPOSTRunning();
+
+// True if all checks have passed so far
+bool isPOSTPassed();
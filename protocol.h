@@ -0,0 +1,75 @@
+/************************************************************************************************
+ * Serial protocol:
+ ************************************************************************************************/
+
+#pragma once
+
+// Shared by the firmware and the host tools, so it has no dependencies on the SPL.
+//
+// Frame: SOF, type, length, payload[length], CRC-16 (low byte first). The CRC is CRC-16/MODBUS
+// over type, length and payload. Multi-byte fields are little-endian.
+
+#define PROTOCOL_SOF          0xA5
+#define PROTOCOL_PAYLOAD_MAX  32
+#define PROTOCOL_OVERHEAD     5 // SOF, type, length, CRC
+#define PROTOCOL_BAUDRATE     57600
+
+#define HISTORY_FRAME_DELTAS  12
+
+typedef enum
+{
+    FRAME_TELEMETRY_KEY   = 0x01, // time_ms (4 bytes) and all fields
+    FRAME_TELEMETRY_DELTA = 0x02, // dt_ms (2 bytes), changed fields mask, changed fields
+    FRAME_BOOT            = 0x03, // boot to first frame us (4), boot to control active us (4),
+                                  //    reset cause. Sent once per boot
+
+    // Requests from the host. The response has type | FRAME_RESPONSE, its first payload byte is
+    // ECommandStatus, then data listed here:
+    CMD_GET_STATUS        = 0x10, // -> on, setpoint, time_left_min (2), temp, hum, heater temp,
+                                  //    heater on, faults
+    CMD_SET_SETPOINT      = 0x11, // degC, one of the menu values
+    CMD_SET_TIME          = 0x12, // hours, one of the menu values
+    CMD_START             = 0x13,
+    CMD_STOP              = 0x14,
+    CMD_GET_PROFILE       = 0x15, // -> start temp, start hours, start on
+    CMD_SAVE_PROFILE      = 0x16, // current setpoint and time become the start profile
+    CMD_GET_STATS         = 0x17, // -> heater_on_s (4), energy_wh (4), sessions (2),
+                                  //    heater_cycles (4), fault counters (18), one per
+                                  //    raised code in the order listed in faults.h
+    CMD_GET_FAULTS        = 0x18, // -> fault flags, fault counters (18), last reset cause,
+                                  //    watchdog resets (2), latched fault (0xFF - none), fault log
+                                  //    newest first: code, uptime_min (2) per entry
+    CMD_SET_TELEMETRY     = 0x19, // period_s, 0 - off
+    CMD_SET_HEATER_WATTS  = 0x1A, // watts (2)
+    CMD_GET_HISTORY       = 0x1B, // tier, first -> count, first, temp, hum, heater temp of the first
+                                  //    sample, up to HISTORY_FRAME_DELTAS packed deltas (2 each)
+                                  //    of the following samples
+
+    FRAME_RESPONSE        = 0x80,
+} EFrameType;
+
+typedef enum
+{
+    STATUS_OK,
+    STATUS_BAD_LENGTH,
+    STATUS_BAD_VALUE,
+    STATUS_UNKNOWN_COMMAND,
+} ECommandStatus;
+
+// Telemetry fields, one byte each, in frame order. Bit N of the delta mask is field N.
+typedef enum
+{
+    TELEMETRY_TEMPERATURE, // chamber, degC, signed
+    TELEMETRY_HUMIDITY,    // chamber, %RH
+    TELEMETRY_HEATER_TEMP, // NTC, degC, signed
+    TELEMETRY_HEATER_DUTY, // % of the record period
+    TELEMETRY_FAN,         // 0 / 1
+    TELEMETRY_SETPOINT,    // degC
+    TELEMETRY_FAULTS,      // FAULT_FLAG_* bits
+    TELEMETRY_FIELDS_COUNT
+} ETelemetryField;
+
+#define FAULT_FLAG_SENSOR 0x01 // AHT20 communication failed
+#define FAULT_FLAG_NTC    0x02 // heater NTC out of table range
+#define FAULT_FLAG_OUTPUT 0x04 // output readback mismatch
+#define FAULT_FLAG_SAFETY 0x08 // latched heater plausibility fault, see safety.h
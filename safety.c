@@ -0,0 +1,149 @@
+/************************************************************************************************
+ * Safety:
+ ************************************************************************************************/
+
+#include <safety.h>
+#include <outputs.h>
+#include <utilities.h>
+
+int8_t           safety_ntc        = 0;
+int8_t           safety_air        = 0;
+bool             safety_valid      = false; // readings have been published at least once
+uint8_t          safety_stale_s    = 0;
+
+volatile uint8_t safety_fault      = FAULT_NONE;
+uint16_t         safety_tick_ms    = 0;
+bool             safety_heater_on  = false;
+uint16_t         safety_phase_s    = 0;     // since the last heater edge, saturates
+int8_t           safety_baseline   = 0;     // NTC at the heater edge, minimum after the grace time
+uint16_t         safety_window_s   = 0;     // since the minimum has been restarted, heater off
+uint8_t          safety_mismatch_s = 0;
+
+// private:
+void latchSafetyFault(EFault fault)
+{
+    if (FAULT_NONE == safety_fault)
+    {
+        safety_fault = fault;
+        setOutputsSafeState(true);
+    }
+}
+
+// private:
+void checkHeaterOn()
+{
+    if (SAFETY_STALE_S <= ++safety_stale_s)
+    {
+        latchSafetyFault(FAULT_READINGS_STALE);
+    }
+
+    if ((SAFETY_RISE_WINDOW_S == safety_phase_s) &&
+        (safety_ntc < (safety_baseline + SAFETY_RISE_MIN_C)))
+    {
+        latchSafetyFault(FAULT_HEATER_NO_RISE);
+    }
+}
+
+// private:
+void checkHeaterOff()
+{
+    // the heater block keeps heating the NTC for a while after switch off
+    if (SAFETY_OFF_GRACE_S > safety_phase_s)
+    {
+        return;
+    }
+
+    safety_window_s++;
+
+    if ((SAFETY_OFF_GRACE_S == safety_phase_s) || (SAFETY_OFF_WINDOW_S <= safety_window_s))
+    {
+        safety_baseline = safety_ntc;
+        safety_window_s = 0;
+    }
+    else if (safety_ntc < safety_baseline)
+    {
+        safety_baseline = safety_ntc;
+    }
+    else if ((safety_ntc >= (safety_baseline + SAFETY_OFF_RISE_MAX_C)) &&
+             (safety_ntc >= (safety_air + SAFETY_OFF_RISE_MAX_C)))
+    {
+        latchSafetyFault(FAULT_HEATER_OFF_RISE);
+    }
+}
+
+// private:
+void checkConsistency(bool heater_on, bool fan_on)
+{
+    bool mismatch = false;
+
+    // without airflow the heater NTC and the chamber air are not coupled
+    if (fan_on)
+    {
+        mismatch = ((safety_air - safety_ntc) > SAFETY_COLD_NTC_C) ||
+                   (!heater_on && (SAFETY_SETTLED_S <= safety_phase_s) &&
+                    ((safety_ntc - safety_air) > SAFETY_SETTLED_DIFF_C));
+    }
+
+    safety_mismatch_s = mismatch ? (safety_mismatch_s + 1) : 0;
+
+    if (SAFETY_MISMATCH_S <= safety_mismatch_s)
+    {
+        latchSafetyFault(FAULT_SENSOR_MISMATCH);
+    }
+}
+
+// public:
+void setSafetyReadings(int8_t heater_temp, int8_t air_temp)
+{
+    CRITICAL
+    {
+        safety_ntc     = heater_temp;
+        safety_air     = air_temp;
+        safety_valid   = true;
+        safety_stale_s = 0;
+    }
+}
+
+// public:
+void handleSafetyTick(bool heater_on, bool fan_on)
+{
+    if (1000 > ++safety_tick_ms)
+    {
+        return;
+    }
+
+    safety_tick_ms = 0;
+
+    if (!safety_valid || (FAULT_NONE != safety_fault))
+    {
+        return;
+    }
+
+    if (heater_on != safety_heater_on)
+    {
+        safety_heater_on = heater_on;
+        safety_phase_s   = 0;
+        safety_baseline  = safety_ntc;
+    }
+    else if (0xFFFF != safety_phase_s)
+    {
+        safety_phase_s++;
+    }
+
+    if (heater_on)
+    {
+        checkHeaterOn();
+    }
+    else
+    {
+        checkHeaterOff();
+    }
+
+    checkConsistency(heater_on, fan_on);
+}
+
+// public:
+EFault getSafetyFault()
+{
+    return safety_fault;
+}
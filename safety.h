@@ -0,0 +1,41 @@
+/************************************************************************************************
+ * Safety:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <faults.h>
+
+// Plausibility of heater NTC and AHT20 readings against the heater state. The checks run once a
+// second from the 1 ms tick with the last readings published by the main loop, so a stalled main
+// loop cannot starve them. The first failed check is latched until reset and forces the outputs
+// to the safe state. Fault codes are FAULT_HEATER_NO_RISE..FAULT_READINGS_STALE in the order below.
+
+// Heater on: NTC must rise by SAFETY_RISE_MIN_C within SAFETY_RISE_WINDOW_S (heater open, NTC detached)
+#define SAFETY_RISE_WINDOW_S  90
+#define SAFETY_RISE_MIN_C     3
+// Heater off: after the grace time NTC must not rise SAFETY_OFF_RISE_MAX_C above its minimum
+// within SAFETY_OFF_WINDOW_S and end up that much above the air (stuck relay). The minimum
+// restarts every window and the air follows the room, so ambient changes don't count.
+#define SAFETY_OFF_GRACE_S    60
+#define SAFETY_OFF_WINDOW_S   300
+#define SAFETY_OFF_RISE_MAX_C 5
+// Fan on: NTC colder than the air, or much hotter after the heater has been off for a long time
+#define SAFETY_COLD_NTC_C     15
+#define SAFETY_SETTLED_S      600
+#define SAFETY_SETTLED_DIFF_C 20
+#define SAFETY_MISMATCH_S     30
+// Heater on: readings must be refreshed
+#define SAFETY_STALE_S        5
+
+// Must be called from the main loop after every measurement
+void setSafetyReadings(int8_t heater_temp, int8_t air_temp);
+
+// Called from the 1 ms tick interrupt
+void handleSafetyTick(bool heater_on, bool fan_on);
+
+// FAULT_NONE or the latched fault. Raising it is left to the main loop
+EFault getSafetyFault();
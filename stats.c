@@ -0,0 +1,174 @@
+/************************************************************************************************
+ * Statistics:
+ ************************************************************************************************/
+
+#include <stats.h>
+#include <journal.h>
+
+#include <string.h>
+
+#define STATS_VERSION 1
+
+// Journal payload is 10 bytes, so counters are split over several records:
+typedef struct
+{
+    uint32_t heater_on_s;
+    uint32_t energy_wh;
+    uint16_t sessions;
+} SStatsUsage;
+
+typedef struct
+{
+    uint32_t heater_cycles;
+} SStatsCounters;
+
+// then fault counters, JOURNAL_PAYLOAD_SIZE per record from JOURNAL_STATS_FAULTS on
+#define STATS_FAULT_RECORDS ((STATS_FAULT_COUNTERS + JOURNAL_PAYLOAD_SIZE - 1) / JOURNAL_PAYLOAD_SIZE)
+
+SStats   lifetime_stats;
+uint16_t energy_ws       = 0; // watt-seconds not yet accounted in energy_wh
+uint16_t store_timer_s   = STATS_STORE_PERIOD_S;
+
+// private:
+// Leaves the record as it is if there is no valid one
+void readStatsRecord(EJournalType type, void *record, uint8_t size)
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    uint8_t version;
+
+    if (readJournal(type, &version, payload) && (STATS_VERSION == version))
+    {
+        memcpy(record, payload, size);
+    }
+}
+
+// private:
+void writeStatsRecord(EJournalType type, const void *record, uint8_t size)
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE] = {0};
+
+    memcpy(payload, record, size);
+    writeJournal(type, STATS_VERSION, payload, 0);
+}
+
+// private:
+// First counter of the fault record is returned, count is the number of its counters
+uint8_t getFaultRecord(uint8_t record, uint8_t *count)
+{
+    uint8_t first = record * JOURNAL_PAYLOAD_SIZE;
+
+    *count = STATS_FAULT_COUNTERS - first;
+    if (JOURNAL_PAYLOAD_SIZE < *count)
+    {
+        *count = JOURNAL_PAYLOAD_SIZE;
+    }
+
+    return first;
+}
+
+// public:
+void initStats()
+{
+    SStatsUsage    usage;
+    SStatsCounters counters;
+
+    memset(&usage,    0, sizeof(usage));
+    memset(&counters, 0, sizeof(counters));
+    memset(lifetime_stats.faults, 0, sizeof(lifetime_stats.faults));
+
+    readStatsRecord(JOURNAL_STATS_USAGE,    &usage,    sizeof(usage));
+    readStatsRecord(JOURNAL_STATS_COUNTERS, &counters, sizeof(counters));
+
+    for (uint8_t i = 0; i < STATS_FAULT_RECORDS; i++)
+    {
+        uint8_t count;
+        uint8_t first = getFaultRecord(i, &count);
+
+        readStatsRecord((EJournalType)(JOURNAL_STATS_FAULTS + i), &lifetime_stats.faults[first], count);
+    }
+
+    lifetime_stats.heater_on_s   = usage.heater_on_s;
+    lifetime_stats.energy_wh     = usage.energy_wh;
+    lifetime_stats.sessions      = usage.sessions;
+    lifetime_stats.heater_cycles = counters.heater_cycles;
+}
+
+// public:
+const SStats* getStats()
+{
+    return &lifetime_stats;
+}
+
+// public:
+void storeStats()
+{
+    SStatsUsage    usage;
+    SStatsCounters counters;
+
+    usage.heater_on_s      = lifetime_stats.heater_on_s;
+    usage.energy_wh        = lifetime_stats.energy_wh;
+    usage.sessions         = lifetime_stats.sessions;
+    counters.heater_cycles = lifetime_stats.heater_cycles;
+
+    writeStatsRecord(JOURNAL_STATS_USAGE,    &usage,    sizeof(usage));
+    writeStatsRecord(JOURNAL_STATS_COUNTERS, &counters, sizeof(counters));
+
+    store_timer_s = STATS_STORE_PERIOD_S;
+}
+
+// public:
+void handleStatsSecond(bool heater_on, uint16_t heater_watts)
+{
+    if (heater_on)
+    {
+        lifetime_stats.heater_on_s++;
+
+        energy_ws += heater_watts;
+        while (3600 <= energy_ws)
+        {
+            energy_ws -= 3600;
+            lifetime_stats.energy_wh++;
+        }
+    }
+
+    store_timer_s--;
+    if (0 == store_timer_s)
+    {
+        storeStats();
+    }
+}
+
+// public:
+void countHeaterCycle()
+{
+    lifetime_stats.heater_cycles++;
+}
+
+// public:
+void countSession()
+{
+    lifetime_stats.sessions++;
+    storeStats();
+}
+
+// public:
+void countFault(EFault fault)
+{
+    uint8_t index  = getFaultIndex(fault);
+    uint8_t record = index / JOURNAL_PAYLOAD_SIZE;
+    uint8_t count;
+    uint8_t first;
+
+    if (STATS_FAULT_COUNTERS <= index)
+    {
+        return;
+    }
+
+    if (0xFF != lifetime_stats.faults[index])
+    {
+        lifetime_stats.faults[index]++;
+    }
+
+    first = getFaultRecord(record, &count);
+    writeStatsRecord((EJournalType)(JOURNAL_STATS_FAULTS + record), &lifetime_stats.faults[first], count);
+}
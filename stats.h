@@ -0,0 +1,46 @@
+/************************************************************************************************
+ * Statistics:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <faults.h>
+
+// Lifetime counters kept in the EEPROM journal. They are counted in RAM and stored at the end of
+// a session, after a fault and every STATS_STORE_PERIOD_S of running, so a power loss costs at
+// most one period of counting.
+
+#define STATS_STORE_PERIOD_S (30u * 60u)
+
+// One counter per code which can be raised, indexed by getFaultIndex()
+#define STATS_FAULT_COUNTERS FAULT_CODES_COUNT
+
+typedef struct
+{
+    uint32_t heater_on_s;
+    uint32_t energy_wh;     // heater on-time multiplied by the configured heater power
+    uint16_t sessions;      // sessions which ran until their time has elapsed
+    uint32_t heater_cycles; // heater relay switch-ons
+    uint8_t  faults[STATS_FAULT_COUNTERS]; // saturate at 255
+} SStats;
+
+// Updated from the main loop only, so it can be read in place there (Modbus input registers)
+extern SStats lifetime_stats;
+
+// Loads counters from the journal, must be called after initJournal()
+void initStats();
+
+const SStats* getStats();
+
+// Must be called every second while the dryer is on
+void handleStatsSecond(bool heater_on, uint16_t heater_watts);
+
+void countHeaterCycle();
+void countSession();
+void countFault(EFault fault);
+
+// Queues the usage and counters records to the journal. Fault counts are stored as they change
+void storeStats();
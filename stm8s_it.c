@@ -106,48 +106,48 @@ INTERRUPT_HANDLER(CLK_IRQHandler, 2)
   * @param  None
   * @retval None
   */
-INTERRUPT_HANDLER(EXTI_PORTA_IRQHandler, 3)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(EXTI_PORTA_IRQHandler, 3)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @brief  External Interrupt PORTB Interrupt routine
   * @param  None
   * @retval None
   */
-INTERRUPT_HANDLER(EXTI_PORTB_IRQHandler, 4)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(EXTI_PORTB_IRQHandler, 4)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @brief  External Interrupt PORTC Interrupt routine
   * @param  None
   * @retval None
   */
-INTERRUPT_HANDLER(EXTI_PORTC_IRQHandler, 5)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(EXTI_PORTC_IRQHandler, 5)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @brief  External Interrupt PORTD Interrupt routine
   * @param  None
   * @retval None
   */
-INTERRUPT_HANDLER(EXTI_PORTD_IRQHandler, 6)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(EXTI_PORTD_IRQHandler, 6)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @brief  External Interrupt PORTE Interrupt routine
@@ -320,24 +320,24 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
   * @param  None
   * @retval None
   */
- INTERRUPT_HANDLER(UART1_TX_IRQHandler, 17)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(UART1_TX_IRQHandler, 17)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @brief  UART1 RX Interrupt routine
   * @param  None
   * @retval None
   */
- INTERRUPT_HANDLER(UART1_RX_IRQHandler, 18)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(UART1_RX_IRQHandler, 18)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 #endif /*STM8S105 || STM8S001 */
 
 /**
@@ -454,12 +454,12 @@ INTERRUPT_HANDLER(TIM6_UPD_OVF_TRG_IRQHandler, 23)
   * @param  None
   * @retval None
   */
- INTERRUPT_HANDLER(TIM4_UPD_OVF_IRQHandler, 23)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(TIM4_UPD_OVF_IRQHandler, 23)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 #endif /*STM8S903*/
 
 /**
@@ -467,12 +467,12 @@ INTERRUPT_HANDLER(TIM6_UPD_OVF_TRG_IRQHandler, 23)
   * @param  None
   * @retval None
   */
-INTERRUPT_HANDLER(EEPROM_EEC_IRQHandler, 24)
-{
-  /* In order to detect unexpected events during development,
-     it is recommended to set a breakpoint on the following instruction.
-  */
-}
+// INTERRUPT_HANDLER(EEPROM_EEC_IRQHandler, 24)
+//{
+//  /* In order to detect unexpected events during development,
+//     it is recommended to set a breakpoint on the following instruction.
+//  */
+//}
 
 /**
   * @}
@@ -0,0 +1,157 @@
+/************************************************************************************************
+ * Telemetry:
+ ************************************************************************************************/
+
+#include <telemetry.h>
+#include <uart.h>
+#include <crc16.h>
+
+uint8_t  telemetry_period_s = TELEMETRY_DEFAULT_RATE;
+uint8_t  telemetry_timer_s  = TELEMETRY_DEFAULT_RATE;
+uint8_t  telemetry_heater_s = 0;  // heater seconds in the current period
+uint8_t  telemetry_to_key   = 0;  // records until the next key frame, 0 - next is a key frame
+uint32_t telemetry_time_ms  = 0;  // time of the last sent record
+uint8_t  telemetry_fields[TELEMETRY_FIELDS_COUNT];
+
+// public:
+void setTelemetryPeriod(uint8_t period_s)
+{
+    // dt of delta frames is 16-bit in ms
+    if (TELEMETRY_PERIOD_MAX < period_s)
+    {
+        period_s = TELEMETRY_PERIOD_MAX;
+    }
+
+    telemetry_period_s = period_s;
+    telemetry_timer_s  = period_s;
+    telemetry_heater_s = 0;
+    telemetry_to_key   = 0;
+}
+
+// public:
+uint8_t getTelemetryPeriod()
+{
+    return telemetry_period_s;
+}
+
+// public:
+bool sendFrame(uint8_t type, const uint8_t *payload, uint8_t size)
+{
+    uint8_t  header[3] = {PROTOCOL_SOF, type, size};
+    uint16_t crc       = CRC16_INIT;
+
+    if (getUARTFreeSpace() < (uint8_t)(size + PROTOCOL_OVERHEAD))
+    {
+        return false;
+    }
+
+    crc = updateCRC16(crc, type);
+    crc = updateCRC16(crc, size);
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        crc = updateCRC16(crc, payload[i]);
+    }
+
+    uint8_t trailer[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+
+    // room was checked above, so the frame is never split
+    writeUART(header, sizeof(header));
+    writeUART(payload, size);
+    writeUART(trailer, sizeof(trailer));
+
+    return true;
+}
+
+// private:
+bool sendRecord(uint32_t time_ms, const uint8_t *fields)
+{
+    uint8_t payload[4 + 1 + TELEMETRY_FIELDS_COUNT];
+    uint8_t size = 0;
+    bool    key  = (0 == telemetry_to_key);
+    uint8_t type = key ? FRAME_TELEMETRY_KEY : FRAME_TELEMETRY_DELTA;
+
+    if (key)
+    {
+        payload[size++] = (uint8_t)time_ms;
+        payload[size++] = (uint8_t)(time_ms >> 8);
+        payload[size++] = (uint8_t)(time_ms >> 16);
+        payload[size++] = (uint8_t)(time_ms >> 24);
+
+        for (uint8_t i = 0; i < TELEMETRY_FIELDS_COUNT; i++)
+        {
+            payload[size++] = fields[i];
+        }
+    }
+    else
+    {
+        uint16_t dt_ms = (uint16_t)(time_ms - telemetry_time_ms);
+        uint8_t  mask  = 0;
+
+        payload[size++] = (uint8_t)dt_ms;
+        payload[size++] = (uint8_t)(dt_ms >> 8);
+        size++; // mask
+
+        for (uint8_t i = 0; i < TELEMETRY_FIELDS_COUNT; i++)
+        {
+            if (fields[i] != telemetry_fields[i])
+            {
+                mask |= 1 << i;
+                payload[size++] = fields[i];
+            }
+        }
+
+        payload[2] = mask;
+    }
+
+    if (!sendFrame(type, payload, size))
+    {
+        telemetry_to_key = 0;
+        return false;
+    }
+
+    telemetry_to_key  = key ? (TELEMETRY_KEY_PERIOD - 1) : (telemetry_to_key - 1);
+    telemetry_time_ms = time_ms;
+
+    for (uint8_t i = 0; i < TELEMETRY_FIELDS_COUNT; i++)
+    {
+        telemetry_fields[i] = fields[i];
+    }
+
+    return true;
+}
+
+// public:
+void handleTelemetrySecond(uint32_t time_ms, const STelemetrySample *sample)
+{
+    if (0 == telemetry_period_s)
+    {
+        return;
+    }
+
+    if (sample->heater_on)
+    {
+        telemetry_heater_s++;
+    }
+
+    telemetry_timer_s--;
+    if (0 != telemetry_timer_s)
+    {
+        return;
+    }
+
+    uint8_t fields[TELEMETRY_FIELDS_COUNT];
+
+    fields[TELEMETRY_TEMPERATURE] = (uint8_t)sample->temperature;
+    fields[TELEMETRY_HUMIDITY]    = sample->humidity;
+    fields[TELEMETRY_HEATER_TEMP] = (uint8_t)sample->heater_temp;
+    fields[TELEMETRY_HEATER_DUTY] = (uint16_t)telemetry_heater_s * 100 / telemetry_period_s;
+    fields[TELEMETRY_FAN]         = sample->fan_on;
+    fields[TELEMETRY_SETPOINT]    = sample->setpoint;
+    fields[TELEMETRY_FAULTS]      = sample->faults;
+
+    sendRecord(time_ms, fields);
+
+    telemetry_timer_s  = telemetry_period_s;
+    telemetry_heater_s = 0;
+}
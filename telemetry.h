@@ -0,0 +1,41 @@
+/************************************************************************************************
+ * Telemetry:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <protocol.h>
+
+// Emits a telemetry record every period as a framed message on UART. A key frame with all
+// fields is sent every TELEMETRY_KEY_PERIOD records, in between only fields which changed are
+// sent. A record which doesn't fit the TX buffer is dropped and the next one is a key frame, so
+// the host never applies a delta to a lost state.
+
+#define TELEMETRY_KEY_PERIOD    16
+#define TELEMETRY_DEFAULT_RATE  1 // seconds between records
+#define TELEMETRY_PERIOD_MAX    60
+
+typedef struct
+{
+    int8_t  temperature;
+    uint8_t humidity;
+    int8_t  heater_temp;
+    bool    heater_on;
+    bool    fan_on;
+    uint8_t setpoint;
+    uint8_t faults;
+} STelemetrySample;
+
+// period_s: seconds between records up to TELEMETRY_PERIOD_MAX, 0 - off
+void setTelemetryPeriod(uint8_t period_s);
+uint8_t getTelemetryPeriod();
+
+// Must be called every second. The heater is switched only once per second, so sampling it
+// here gives exact duty
+void handleTelemetrySecond(uint32_t time_ms, const STelemetrySample *sample);
+
+// Frames payload and queues it to UART. False if the TX buffer has no room
+bool sendFrame(uint8_t type, const uint8_t *payload, uint8_t size);
@@ -6,6 +6,8 @@
 
 #include <utilities.h>
 
+#include <stdarg.h>
+
 enum ECommand
 {
     WRITE              = 0b1010000000000,
@@ -25,9 +27,27 @@ enum ECommand
     COMMAND_TNORMAL    = 0b100111000110,
 };
 
-const uint8_t digit2segments[] =
+// 7-segment font for ASCII 0x20..0x5F, lowercase letters are shown as uppercase ones.
+// Letters which can't be drawn are approximated by their lowercase form.
+const uint8_t font[] =
 {
     //gfedcba
+    0b0000000, // ' '
+    0b0000110, // !
+    0b0100010, // "
+    0b1001001, // #
+    0b1101101, // $
+    0b0100100, // %
+    0b1111111, // &
+    0b0000010, // '
+    0b0111001, // (
+    0b0001111, // )
+    0b1100011, // * - shown as degree sign
+    0b1000110, // +
+    0b0010000, // ,
+    0b1000000, // -
+    0b0010000, // .
+    0b1010010, // /
     0b0111111, // 0
     0b0000110, // 1
     0b1011011, // 2
@@ -38,19 +58,51 @@ const uint8_t digit2segments[] =
     0b0000111, // 7
     0b1111111, // 8
     0b1101111, // 9
-/*
+    0b0001001, // :
+    0b0001001, // ;
+    0b1011000, // <
+    0b1001000, // =
+    0b1001100, // >
+    0b1010011, // ?
+    0b1011111, // @
     0b1110111, // A
     0b1111100, // b
-    0b1011000, // c
-    0b1011111, // d
+    0b0111001, // C
+    0b1011110, // d
     0b1111001, // E
     0b1110001, // F
-    0b1101111, // g
-    0b1110100, // h
+    0b0111101, // G
     0b1110110, // H
-*/
+    0b0110000, // I
+    0b0011110, // J
+    0b1110101, // K
+    0b0111000, // L
+    0b0110111, // M
+    0b1010100, // n
+    0b0111111, // O
+    0b1110011, // P
+    0b1100111, // q
+    0b1010000, // r
+    0b1101101, // S
+    0b1111000, // t
+    0b0111110, // U
+    0b0011100, // v
+    0b1111110, // W
+    0b1110110, // X
+    0b1101110, // y
+    0b1011011, // Z
+    0b0111001, // [
+    0b1100100, // backslash
+    0b0001111, // ]
+    0b0100011, // ^
+    0b0001000, // _
 };
 
+#define FONT_FIRST_CHAR ' '
+#define FONT_LAST_CHAR  '_'
+
+const uint16_t powers_of_10[] = {10000, 1000, 100, 10, 1};
+
 uint8_t disp_data[] =
 {
     0b1111, // 1A 2A 3A 4A          0
@@ -75,6 +127,36 @@ uint8_t disp_data[] =
 
 const uint8_t segment2address[] = {0, 1, 2, 3, 4, 5, 13};
 
+// Icon positions, indexed by EDispItem:
+const uint8_t item2address[] = {14, 14, 14, 14, 15, 15};
+const uint8_t item2bit[]     = {3,  2,  1,  0,  3,  2};
+
+// Effects state. Effects are applied while the frame is sent, disp_data is never modified.
+volatile uint8_t blink_digit_mask   = 0;    // bit N - digit N blinks, as RAM cell bits
+volatile uint8_t blink_icon_mask[2] = {0};  // RAM cells 14 and 15
+volatile bool    blink_visible      = true;
+uint16_t         blink_timer_ms     = DISP_BLINK_PERIOD_MS;
+
+volatile bool    scroll_active      = false;
+bool             scroll_repeat      = false;
+uint8_t          scroll_text[DISP_SCROLL_MAX_LEN];
+uint8_t          scroll_len         = 0;
+uint8_t          scroll_pos         = 0;
+uint16_t         scroll_step_ms     = 0;
+uint16_t         scroll_timer_ms    = 0;
+uint8_t          scroll_cells[7];           // segment RAM cells of the visible window
+
+volatile uint8_t backlight_level    = 0;
+uint8_t          backlight_target   = 0;
+uint16_t         fade_step_ms       = 0;
+uint16_t         fade_timer_ms      = 0;
+uint8_t          pwm_counter        = 0;
+bool             backlight_on       = false;
+
+volatile uint8_t disp_update_depth = 0;
+volatile bool    disp_dirty        = true;  // LCD RAM content is undefined after power on
+volatile bool    disp_flushing     = false;
+
 GPIO_TypeDef*    port_cs        = GPIOA;
 GPIO_Pin_TypeDef pin_cs         = GPIO_PIN_0;
 GPIO_TypeDef*    port_wr        = GPIOA;
@@ -89,6 +171,62 @@ GPIO_Pin_TypeDef pin_backlight  = GPIO_PIN_0;
 #define DATA      port_data,      pin_data
 #define BACKLIGHT port_backlight, pin_backlight
 
+/************************************************************************************************
+ * Transport:
+ ************************************************************************************************/
+
+#if (TM1621C_TRANSPORT == TM1621C_TRANSPORT_GPIO)
+
+#define CS_LOW()    writePin(CS,   0)
+#define CS_HIGH()   writePin(CS,   1)
+#define WR_LOW()    writePin(WR,   0)
+#define WR_HIGH()   writePin(WR,   1)
+#define DATA_LOW()  writePin(DATA, 0)
+#define DATA_HIGH() writePin(DATA, 1)
+
+// Library calls are slow enough to satisfy WR pulse width
+#define WR_DELAY()
+
+#else
+
+// Constant port address and pin mask let the compiler emit single bset/bres instructions
+#define CS_LOW()    (TM1621C_CS_PORT->ODR   &= (uint8_t)~TM1621C_CS_PIN)
+#define CS_HIGH()   (TM1621C_CS_PORT->ODR   |= (uint8_t)TM1621C_CS_PIN)
+#define WR_LOW()    (TM1621C_WR_PORT->ODR   &= (uint8_t)~TM1621C_WR_PIN)
+#define WR_HIGH()   (TM1621C_WR_PORT->ODR   |= (uint8_t)TM1621C_WR_PIN)
+#define DATA_LOW()  (TM1621C_DATA_PORT->ODR &= (uint8_t)~TM1621C_DATA_PIN)
+#define DATA_HIGH() (TM1621C_DATA_PORT->ODR |= (uint8_t)TM1621C_DATA_PIN)
+
+#define WR_DELAY()                                                  \
+    for (uint8_t delay = TM1621C_WR_DELAY_LOOPS; delay; delay--)    \
+    {                                                               \
+        nop();                                                      \
+    }
+
+#endif
+
+// private:
+// Shifts out the lowest 'bits' bits of data, MSB first. Data is latched on WR rising edge.
+void writeBits(uint16_t data, uint8_t bits)
+{
+    for (uint16_t mask = 1 << (bits - 1); 0 != mask; mask >>= 1)
+    {
+        if (data & mask)
+        {
+            DATA_HIGH();
+        }
+        else
+        {
+            DATA_LOW();
+        }
+
+        WR_LOW();
+        WR_DELAY();
+        WR_HIGH();
+        WR_DELAY();
+    }
+}
+
 void writeTM1621C(uint16_t data);
 
 void initTM1621C(GPIO_TypeDef* in_port_cs,        GPIO_Pin_TypeDef in_pin_cs,
@@ -106,9 +244,9 @@ void initTM1621C(GPIO_TypeDef* in_port_cs,        GPIO_Pin_TypeDef in_pin_cs,
     pin_backlight  = in_pin_backlight;
 
 
-    GPIO_Init(port_cs,        pin_cs,        GPIO_MODE_OUT_PP_LOW_FAST);
-    GPIO_Init(port_wr,        pin_wr,        GPIO_MODE_OUT_PP_LOW_FAST);
-    GPIO_Init(port_data,      pin_data,      GPIO_MODE_OUT_PP_LOW_FAST);
+    GPIO_Init(port_cs,        pin_cs,        GPIO_MODE_OUT_PP_HIGH_FAST);
+    GPIO_Init(port_wr,        pin_wr,        GPIO_MODE_OUT_PP_HIGH_FAST);
+    GPIO_Init(port_data,      pin_data,      GPIO_MODE_OUT_PP_HIGH_FAST);
     GPIO_Init(port_backlight, pin_backlight, GPIO_MODE_OUT_PP_LOW_FAST);
 
     writeTM1621C(COMMAND_SYS_EN);
@@ -119,48 +257,139 @@ void initTM1621C(GPIO_TypeDef* in_port_cs,        GPIO_Pin_TypeDef in_pin_cs,
 
 void setBacklightState(bool active)
 {
-    writePin(BACKLIGHT, active);
+    uint8_t level = active ? DISP_BACKLIGHT_LEVELS : 0;
+
+    backlight_target = level;
+    backlight_level  = level;
 }
 
-void writeTM1621C(uint16_t data)
+// private:
+// Returns RAM cell content with effects applied
+uint8_t getOutputCell(uint8_t addr)
 {
-    const uint16_t pause = 10;
+    uint8_t cell    = disp_data[addr];
+    uint8_t segment = 0xFF;
 
-    writePin(CS, 0);
-    uint8_t len = 12;
-    if (0 != (data & (1 << 11)))
+    if (addr < 6)
+    {
+        segment = addr;
+    }
+    else if (13 == addr)
+    {
+        segment = 6;
+    }
+
+    if (0xFF != segment)
+    {
+        if (scroll_active)
+        {
+            cell = scroll_cells[segment];
+        }
+
+        if (!blink_visible)
+        {
+            cell &= ~blink_digit_mask;
+        }
+    }
+    else if ((!blink_visible) && (14 <= addr) && (15 >= addr))
     {
-        len = 11; // for commands
+        cell &= ~blink_icon_mask[addr - 14];
     }
 
-    for (int8_t bit = len; bit >= 0; bit--)
+    return cell;
+}
+
+void writeTM1621C(uint16_t data)
+{
+    uint8_t len = 13;
+    if (0 != (data & (1 << 11)))
     {
-        writePin(DATA, 0 != (data & (1 << bit)));
-        writePin(WR,   0);
-        writePin(WR,   1);
+        len = 12; // for commands
     }
 
-    writePin(DATA, 1);
-    writePin(CS,   1);
+    CS_LOW();
+    writeBits(data, len);
+    DATA_HIGH();
+    CS_HIGH();
 }
 
+// Uses successive address writing: one 9 bit header (ID + start address 0) followed by all RAM
+// cells, 81 bits per frame instead of 18 separate 13 bit writes.
 void writeDispData()
 {
-    for (char addr = 0; addr < 18; addr++)
+    CS_LOW();
+    writeBits(WRITE >> 4, 9);
+
+    for (uint8_t addr = 0; addr < sizeof(disp_data); addr++)
+    {
+        writeBits(getOutputCell(addr), 4);
+    }
+
+    DATA_HIGH();
+    CS_HIGH();
+}
+
+// private:
+void flushDisp()
+{
+    // Effects may mark the frame dirty from the tick while a flush is in progress, the loop of
+    // the running flush picks that up.
+    if ((0 == disp_update_depth) && !disp_flushing)
+    {
+        disp_flushing = true;
+
+        while (disp_dirty)
+        {
+            disp_dirty = false;
+            writeDispData();
+        }
+
+        disp_flushing = false;
+    }
+}
+
+// public:
+void beginDispUpdate()
+{
+    disp_update_depth++;
+}
+
+// public:
+void commitDispUpdate()
+{
+    if (0 != disp_update_depth)
+    {
+        disp_update_depth--;
+    }
+
+    flushDisp();
+}
+
+// private:
+void setDispData(uint8_t addr, uint8_t data)
+{
+    if (data != disp_data[addr])
     {
-        writeTM1621C(WRITE | (addr << 4) | (disp_data[addr]));
+        disp_data[addr] = data;
+        disp_dirty      = true;
     }
 }
 
 void setDigitSegments(uint8_t pos, uint8_t segments)
 {
+    const uint8_t mask = 1 << (3 - pos);
+
     for (uint8_t i = 0; i < 7; i++)
     {
-        disp_data[segment2address[i]] &= ~(1 << (3 - pos));
+        uint8_t addr = segment2address[i];
+        uint8_t data = disp_data[addr] & ~mask;
+
         if (segments & (1 << i))
         {
-            disp_data[segment2address[i]] |= 1 << (3 - pos);
+            data |= mask;
         }
+
+        setDispData(addr, data);
     }
 }
 
@@ -168,169 +397,550 @@ void clearDisp()
 {
     for (uint8_t i = 0; i < sizeof(disp_data); i++)
     {
-        disp_data[i] = 0;
+        setDispData(i, 0);
     }
 
-    writeDispData();
+    flushDisp();
 }
 
-void printDigits(uint8_t left, uint8_t right)
+/************************************************************************************************
+ * Text:
+ ************************************************************************************************/
+
+// public:
+uint8_t charToSegments(char c)
 {
-    // clear right digits:
-//    for (uint8_t j = 0; j < 6; j++)
-//    {
-//        disp_data[j] = 0;
-//    }
+    if (('a' <= c) && ('z' >= c))
+    {
+        c -= 'a' - 'A';
+    }
 
-//    disp_data[13] = 0;
+    if ((FONT_FIRST_CHAR > c) || (FONT_LAST_CHAR < c))
+    {
+        return 0;
+    }
 
-    uint8_t digits[4];
-    digits[0] = left  / 10; // left digit
-    digits[1] = left  % 10;
-    digits[2] = right / 10;
-    digits[3] = right % 10; // right digit
+    return font[c - FONT_FIRST_CHAR];
+}
 
-    uint8_t start = 0;
-    uint8_t stop  = 4;
+// private:
+// Writes decimal digits of value to buffer, at least min_digits of them (zero padded) and
+// returns their count. Uses subtraction only, no divisions.
+uint8_t formatDecimal(char *buffer, uint16_t value, uint8_t min_digits)
+{
+    uint8_t len = 0;
 
-    if (0xFF == left)
+    for (uint8_t i = 0; i < sizeof(powers_of_10) / sizeof(uint16_t); i++)
     {
-        start = 2;
+        uint16_t power = powers_of_10[i];
+        char     digit = '0';
+
+        while (value >= power)
+        {
+            value -= power;
+            digit++;
+        }
+
+        // 5 is the maximal number of decimal digits of uint16_t
+        if ((0 != len) || ('0' != digit) || ((5 - i) <= min_digits) || (1 == power))
+        {
+            buffer[len++] = digit;
+        }
     }
 
-    if (0xFF == right)
+    return len;
+}
+
+// private:
+// Supports %c, %s, %d, %u and %% with an optional '0' flag and field width.
+uint8_t formatText(char *buffer, uint8_t size, const char *format, va_list args)
+{
+    uint8_t len = 0;
+
+    for (; ('\0' != *format) && (len < (size - 1)); format++)
     {
-        stop = 2;
+        if ('%' != *format)
+        {
+            buffer[len++] = *format;
+            continue;
+        }
+
+        format++;
+
+        char    pad   = ' ';
+        uint8_t width = 0;
+
+        if ('0' == *format)
+        {
+            pad = '0';
+            format++;
+        }
+
+        while (('0' <= *format) && ('9' >= *format))
+        {
+            width = width * 10 + (*format - '0');
+            format++;
+        }
+
+        char    field[7];
+        uint8_t field_len = 0;
+
+        switch (*format)
+        {
+            case 'c':
+                field[field_len++] = (char)va_arg(args, int);
+                break;
+
+            case 's':
+            {
+                const char *text = va_arg(args, const char*);
+                while (('\0' != *text) && (len < (size - 1)))
+                {
+                    buffer[len++] = *text++;
+                }
+                continue;
+            }
+
+            case 'd':
+            {
+                int16_t value = (int16_t)va_arg(args, int);
+                if (value < 0)
+                {
+                    field[field_len++] = '-';
+                    value = -value;
+                }
+                field_len += formatDecimal(&field[field_len], (uint16_t)value, 1);
+                break;
+            }
+
+            case 'u':
+                field_len = formatDecimal(field, (uint16_t)va_arg(args, unsigned int), 1);
+                break;
+
+            case '\0':
+                format--; // let the loop see the end of the string
+                continue;
+
+            default:
+                field[field_len++] = *format;
+                break;
+        }
+
+        uint8_t fill  = (width > field_len) ? (width - field_len) : 0;
+        uint8_t start = 0;
+
+        // zero padding goes after the sign
+        if (('0' == pad) && (0 != field_len) && ('-' == field[0]) && (0 != fill))
+        {
+            buffer[len++] = '-';
+            start = 1;
+        }
+
+        for (; (0 != fill) && (len < (size - 1)); fill--)
+        {
+            buffer[len++] = pad;
+        }
+
+        for (uint8_t i = start; (i < field_len) && (len < (size - 1)); i++)
+        {
+            buffer[len++] = field[i];
+        }
     }
 
-    for (uint8_t i = start; i < stop; i++)
-    {
-        uint8_t digit = digits[i];
+    buffer[len] = '\0';
+    return len;
+}
 
-        if (digit < 10)
+// public:
+void printString(const char *text)
+{
+    beginDispUpdate();
+
+    for (uint8_t pos = 0; pos < 4; pos++)
+    {
+        if ((2 == pos) && (':' == *text))
         {
-            digit = digit2segments[digit];
+            setItemStatus(DISP_COLON, true);
+            text++;
         }
-        else
+
+        uint8_t segments = 0;
+        if ('\0' != *text)
         {
-            digit = 0;
+            segments = charToSegments(*text++);
         }
 
-        setDigitSegments(i, digit);
+        setDigitSegments(pos, segments);
+    }
+
+    commitDispUpdate();
+}
+
+// public:
+void printFormat(const char *format, ...)
+{
+    char    buffer[DISP_SCROLL_MAX_LEN + 1];
+    va_list args;
+
+    va_start(args, format);
+    formatText(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    printString(buffer);
+}
+
+// public:
+void scrollString(const char *text, uint16_t step_ms, bool repeat)
+{
+    uint8_t segments[DISP_SCROLL_MAX_LEN];
+    uint8_t count = 0;
+
+    while (('\0' != *text) && (count < sizeof(segments)))
+    {
+        segments[count++] = charToSegments(*text++);
+    }
+
+    scrollSegments(segments, count, step_ms, repeat);
+}
+
+// public:
+void scrollFormat(uint16_t step_ms, bool repeat, const char *format, ...)
+{
+    char    buffer[DISP_SCROLL_MAX_LEN + 1];
+    va_list args;
+
+    va_start(args, format);
+    formatText(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    scrollString(buffer, step_ms, repeat);
+}
+
+void printDigits(uint8_t left, uint8_t right)
+{
+    char    text[5];
+    uint8_t len = 0;
+
+    // 0xFF hides the pair
+    if (0xFF == left)
+    {
+        text[len++] = ' ';
+        text[len++] = ' ';
+    }
+    else
+    {
+        len += formatDecimal(&text[len], (left < 100) ? left : 99, 2);
     }
 
-    writeDispData();
+    if (0xFF == right)
+    {
+        text[len++] = ' ';
+        text[len++] = ' ';
+    }
+    else
+    {
+        len += formatDecimal(&text[len], (right < 100) ? right : 99, 2);
+    }
+
+    text[len] = '\0';
+    printString(text);
 }
 
 void printNumberWithPreffix(uint8_t prefix_bitmap, uint16_t number)
 {
+    beginDispUpdate();
+
+    if (999 < number)
+    {
+        printString(" ---");
+    }
+    else
+    {
+        printFormat(" %3u", number);
+    }
 
     setDigitSegments(0, prefix_bitmap);
 
-    if (999 < number)
+    commitDispUpdate();
+}
+
+void printErr(uint8_t err)
+{
+    beginDispUpdate();
+    clearDisp();
+
+    if (err < 100)
     {
-        setDigitSegments(1, 0b1000000);
-        setDigitSegments(2, 0b1000000);
-        setDigitSegments(3, 0b1000000);
+        printFormat("Er%02u", err);
     }
     else
     {
-        uint8_t digit0 = number / 100;
-        uint8_t digit1 = (number % 100) / 10;
-        uint8_t digit2 = (number % 10);
+        printString("ErEr");
+    }
 
-        if (0 == digit0)
-        {
-            setDigitSegments(1, 0b0000000);
-        }
-        else
+    commitDispUpdate();
+}
+
+void setBit(uint8_t addr, uint8_t bit, bool status)
+{
+    if (status)
+    {
+        setDispData(addr, disp_data[addr] | (1 << bit));
+    }
+    else
+    {
+        setDispData(addr, disp_data[addr] & ~(1 << bit));
+    }
+}
+
+void setItemStatus(EDispItem item, bool status)
+{
+    if (item < sizeof(item2address))
+    {
+        setBit(item2address[item], item2bit[item], status);
+    }
+
+    flushDisp();
+}
+
+/************************************************************************************************
+ * Effects:
+ ************************************************************************************************/
+
+// private:
+// Marks the frame as changed by an effect. Called from the tick, which must not spend a frame
+// time on the transport, so handleDisp() or the next commit sends it.
+void refreshEffects()
+{
+    disp_dirty = true;
+}
+
+// public:
+void handleDisp()
+{
+    flushDisp();
+}
+
+// public:
+void setDigitBlinkMask(uint8_t mask)
+{
+    uint8_t cell_mask = 0;
+
+    for (uint8_t pos = 0; pos < 4; pos++)
+    {
+        if (mask & (1 << pos))
         {
-            setDigitSegments(1, digit2segments[digit0]);
+            cell_mask |= 1 << (3 - pos);
         }
+    }
+
+    if (cell_mask != blink_digit_mask)
+    {
+        blink_digit_mask = cell_mask;
+        disp_dirty       = true;
+    }
+
+    flushDisp();
+}
+
+// public:
+void setItemBlink(EDispItem item, bool blink)
+{
+    if (item < sizeof(item2address))
+    {
+        uint8_t cell = item2address[item] - 14;
+        uint8_t bit  = 1 << item2bit[item];
+        uint8_t mask = blink ? (blink_icon_mask[cell] | bit) : (blink_icon_mask[cell] & ~bit);
 
-        if ((0 == digit0) && (0 == digit1))
+        if (mask != blink_icon_mask[cell])
         {
-            setDigitSegments(2, 0xb0000000);
+            blink_icon_mask[cell] = mask;
+            disp_dirty            = true;
         }
-        else
+    }
+
+    flushDisp();
+}
+
+// private:
+void updateScrollCells()
+{
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        uint8_t cell = 0;
+
+        for (uint8_t pos = 0; pos < 4; pos++)
         {
-            setDigitSegments(2, digit2segments[digit1]);
+            uint8_t index = scroll_pos + pos;
+
+            if ((index < scroll_len) && (scroll_text[index] & (1 << i)))
+            {
+                cell |= 1 << (3 - pos);
+            }
         }
 
-        setDigitSegments(3, digit2segments[digit2]);
+        scroll_cells[i] = cell;
     }
-
-    writeDispData();
 }
 
-void printErr(uint8_t err)
+// public:
+void scrollSegments(const uint8_t *segments, uint8_t count, uint16_t step_ms, bool repeat)
 {
-    clearDisp();
+    if (DISP_SCROLL_MAX_LEN < count)
+    {
+        count = DISP_SCROLL_MAX_LEN;
+    }
 
-    uint8_t segments_E = 0b1111001;
-    uint8_t segments_r = 0b1010000;
+    scroll_active = false; // keep tick away while the message is replaced
 
-    setDigitSegments(0, segments_E);
-    setDigitSegments(1, segments_r);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        scroll_text[i] = segments[i];
+    }
 
-    if (err < 99)
+    scroll_len      = count;
+    scroll_pos      = 0;
+    scroll_step_ms  = step_ms;
+    scroll_timer_ms = step_ms;
+    scroll_repeat   = repeat;
+
+    updateScrollCells();
+
+    scroll_active = true;
+    refreshEffects();
+}
+
+// public:
+void stopScroll()
+{
+    if (scroll_active)
     {
-        setDigitSegments(2, digit2segments[err / 10]);
-        setDigitSegments(3, digit2segments[err % 10]);
+        scroll_active = false;
+        refreshEffects();
     }
-    else
+}
+
+// public:
+bool isScrollActive()
+{
+    return scroll_active;
+}
+
+// public:
+void fadeBacklight(uint8_t level, uint16_t step_ms)
+{
+    if (DISP_BACKLIGHT_LEVELS < level)
     {
-        setDigitSegments(2, segments_E);
-        setDigitSegments(3, segments_r);
+        level = DISP_BACKLIGHT_LEVELS;
     }
 
-    writeDispData();
+    fade_step_ms     = step_ms;
+    fade_timer_ms    = step_ms;
+    backlight_target = level;
+
+    if (0 == step_ms)
+    {
+        backlight_level = level;
+    }
 }
 
-void setBit(uint8_t *byte, uint8_t bit, bool status)
+// private:
+void handleBlinkTick()
 {
-    if (status)
+    if ((0 == blink_digit_mask) && (0 == blink_icon_mask[0]) && (0 == blink_icon_mask[1]))
     {
-        *byte |= 1 << bit;
+        if (!blink_visible)
+        {
+            blink_visible = true;
+            refreshEffects();
+        }
+        return;
     }
-    else
+
+    blink_timer_ms--;
+    if (0 == blink_timer_ms)
     {
-        *byte &= ~(1 << bit);
+        blink_timer_ms = DISP_BLINK_PERIOD_MS;
+        blink_visible  = !blink_visible;
+        refreshEffects();
     }
 }
 
-void setItemStatus(EDispItem item, bool status)
+// private:
+void handleScrollTick()
 {
-    switch (item)
+    if (!scroll_active)
     {
-        case DISP_DEG_C:
-            setBit(&disp_data[14], 3, status);
-            break;
+        return;
+    }
 
-        case DISP_PERCENT:
-            setBit(&disp_data[14], 2, status);
-            break;
+    scroll_timer_ms--;
+    if (0 != scroll_timer_ms)
+    {
+        return;
+    }
 
-        case DISP_TEMP:
-            setBit(&disp_data[14], 1, status);
-            break;
+    scroll_timer_ms = scroll_step_ms;
 
-        case DISP_WORK:
-            setBit(&disp_data[14], 0, status);
-            break;
+    // the last step is the window ending with the last character
+    if ((scroll_pos + 4) < scroll_len)
+    {
+        scroll_pos++;
+    }
+    else if (scroll_repeat)
+    {
+        scroll_pos = 0;
+    }
+    else
+    {
+        scroll_active = false;
+    }
 
-        case DISP_COLON:
-            setBit(&disp_data[15], 3, status);
-            break;
+    updateScrollCells();
+    refreshEffects();
+}
 
-        case DISP_TIME:
-            setBit(&disp_data[15], 2, status);
-            break;
+// private:
+void handleBacklightTick()
+{
+    if ((backlight_level != backlight_target) && (0 != fade_step_ms))
+    {
+        fade_timer_ms--;
+        if (0 == fade_timer_ms)
+        {
+            fade_timer_ms = fade_step_ms;
+
+            if (backlight_level < backlight_target)
+            {
+                backlight_level++;
+            }
+            else
+            {
+                backlight_level--;
+            }
+        }
+    }
+
+    // software PWM, period is DISP_BACKLIGHT_LEVELS ticks
+    pwm_counter++;
+    if (DISP_BACKLIGHT_LEVELS <= pwm_counter)
+    {
+        pwm_counter = 0;
+    }
 
-        default:
-            // do nothing
-            break;
+    // pin is also refreshed once per period in case a main loop read-modify-write lost it
+    bool on = pwm_counter < backlight_level;
+    if ((on != backlight_on) || (0 == pwm_counter))
+    {
+        backlight_on = on;
+        writePin(BACKLIGHT, on);
     }
+}
 
-    writeDispData();
+// public:
+void handleDispTick()
+{
+    handleBlinkTick();
+    handleScrollTick();
+    handleBacklightTick();
 }
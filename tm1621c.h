@@ -9,6 +9,46 @@
 
 #include <stm8s.h>
 
+/* Serial transport ---------------------------------------------------------------------------*/
+/*
+ * ESTIMATES, NOT MEASUREMENTS. Throughput at 16 MHz for one full frame (18 RAM cells, 9 bytes
+ * of segment data), derived from instruction counts and WR timing:
+ *  GPIO      - runtime pins through writePin(), ~150 cycles/bit:             ~0.8 ms, ~12 kB/s
+ *  FAST_GPIO - compile-time pins, bset/bres on ODR, bounded by WR timing:    ~0.6 ms, ~15 kB/s
+ *
+ * There is no SPI transport: the SPI peripheral needs DATA on MOSI (PC6), this board has it
+ * on PC7.
+ */
+
+#define TM1621C_TRANSPORT_GPIO      0
+#define TM1621C_TRANSPORT_FAST_GPIO 1
+
+#ifndef TM1621C_TRANSPORT
+#define TM1621C_TRANSPORT TM1621C_TRANSPORT_FAST_GPIO
+#endif
+
+// Compile-time pin binding for FAST_GPIO transport. The application passes these to
+// initTM1621C() too, so both transports drive the same pins.
+#ifndef TM1621C_CS_PORT
+#define TM1621C_CS_PORT   GPIOA
+#define TM1621C_CS_PIN    GPIO_PIN_1
+#endif
+
+#ifndef TM1621C_WR_PORT
+#define TM1621C_WR_PORT   GPIOC
+#define TM1621C_WR_PIN    GPIO_PIN_5
+#endif
+
+#ifndef TM1621C_DATA_PORT
+#define TM1621C_DATA_PORT GPIOC
+#define TM1621C_DATA_PIN  GPIO_PIN_7
+#endif
+
+// WR half period stretch for FAST_GPIO, ~5 cycles per loop
+#ifndef TM1621C_WR_DELAY_LOOPS
+#define TM1621C_WR_DELAY_LOOPS 8
+#endif
+
 typedef enum
 {
     DISP_DEG_C,
@@ -26,13 +66,69 @@ void initTM1621C(GPIO_TypeDef* port_name_cs,      GPIO_Pin_TypeDef port_pin_cs,
 
 void clearDisp();
 
+// Display transactions: all updates between begin and commit are sent to the LCD by one flush.
+// Transactions may be nested, the flush happens on the outermost commit and only if the
+// frame has actually changed.
+void beginDispUpdate();
+void commitDispUpdate();
+
+// Prints two numbers 0..99 on the left and right digit pairs, 0xFF leaves a pair blank
 void printDigits(uint8_t left, uint8_t right);
 void printNumberWithPreffix(uint8_t prefix_bitmap, uint16_t number);
 
+// Text rendering through the 7-segment font. Rendering uses table lookups and subtraction only.
+uint8_t charToSegments(char c);
+
+// Prints up to 4 characters, the rest is blank. ':' after the second character turns the colon
+// icon on and doesn't take a position.
+void printString(const char *text);
+
+// printf-like, supports %c, %s, %d, %u, %% with optional '0' flag and width
+void printFormat(const char *format, ...);
+
 void setDigitSegments(uint8_t pos, uint8_t segments);
 
 void setBacklightState(bool active);
 
 void setItemStatus(EDispItem item, bool status);
 
+/* Effects ------------------------------------------------------------------------------------*/
+// Effects are driven by handleDispTick() and applied while the frame is sent to the LCD by
+// handleDisp(). The framebuffer is not modified and nothing is sent while no effect changes
+// its state.
+
+#ifndef DISP_BLINK_PERIOD_MS
+#define DISP_BLINK_PERIOD_MS  300
+#endif
+
+#ifndef DISP_SCROLL_MAX_LEN
+#define DISP_SCROLL_MAX_LEN   16
+#endif
+
+// Backlight PWM period in ticks, also the maximal brightness level
+#ifndef DISP_BACKLIGHT_LEVELS
+#define DISP_BACKLIGHT_LEVELS 8
+#endif
+
+// Bit N of the mask - digit N (0 is the leftmost) blinks
+void setDigitBlinkMask(uint8_t mask);
+void setItemBlink(EDispItem item, bool blink);
+
+// Shows segment bitmaps over the digits, shifting one position every step_ms. The message is
+// copied. Without repeat the overlay disappears after the last step.
+void scrollSegments(const uint8_t *segments, uint8_t count, uint16_t step_ms, bool repeat);
+void scrollString(const char *text, uint16_t step_ms, bool repeat);
+void scrollFormat(uint16_t step_ms, bool repeat, const char *format, ...);
+void stopScroll();
+bool isScrollActive();
+
+// Changes backlight level by one every step_ms, 0 - immediately
+void fadeBacklight(uint8_t level, uint16_t step_ms);
+
+// Must be called every 1 ms, it only marks the frame changed
+void handleDispTick();
+
+// Sends frame changes made by the effects, must be called from the main loop
+void handleDisp();
+
 void printErr(uint8_t err);
@@ -0,0 +1,172 @@
+/************************************************************************************************
+ * Session analysis:
+ ************************************************************************************************/
+
+#include "analysis.h"
+
+#include <protocol.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// private:
+double getSeconds(const SRecords *records, size_t a, size_t b)
+{
+    return (records->records[b].time_ms - records->records[a].time_ms) / 1000.0;
+}
+
+// private:
+// Fits RH(t) = rh_inf + A * exp(-t / tau) by least squares over ln(RH - rh_inf), where rh_inf is
+// taken a bit below the lowest RH of the session
+double fitHumidityDecay(const SRecords *records, size_t first, size_t last)
+{
+    double rh_min = 255;
+
+    for (size_t i = first; i <= last; i++)
+    {
+        if (records->records[i].humidity < rh_min)
+        {
+            rh_min = records->records[i].humidity;
+        }
+    }
+
+    double rh_inf = rh_min - 0.5;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    size_t n  = 0;
+
+    for (size_t i = first; i <= last; i++)
+    {
+        double x = getSeconds(records, first, i);
+        double y = log(records->records[i].humidity - rh_inf);
+
+        sx  += x;
+        sy  += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+
+    double d = n * sxx - sx * sx;
+
+    if ((3 > n) || (0 == d))
+    {
+        return -1;
+    }
+
+    double slope = (n * sxy - sx * sy) / d;
+
+    return (0 > slope) ? (-1 / slope) : -1;
+}
+
+// private:
+void analyseSession(const SRecords *records, double heater_watts, SSessionStats *stats)
+{
+    const SRecord *start = &records->records[stats->first];
+
+    stats->duration_s         = getSeconds(records, stats->first, stats->last);
+    stats->setpoint           = start->setpoint;
+    stats->time_to_setpoint_s = -1;
+    stats->overshoot          = 0;
+    stats->rh_start           = start->humidity;
+    stats->rh_end             = records->records[stats->last].humidity;
+    stats->rh_tau_s           = fitHumidityDecay(records, stats->first, stats->last);
+    stats->energy_wh          = 0;
+    stats->faults             = 0;
+
+    double duty_s = 0;
+
+    for (size_t i = stats->first; i <= stats->last; i++)
+    {
+        const SRecord *r = &records->records[i];
+
+        stats->faults |= r->faults;
+
+        if (i > stats->first)
+        {
+            // duty reported with a record covers the period before it
+            duty_s += getSeconds(records, i - 1, i) * r->heater_duty / 100.0;
+        }
+
+        if ((0 > stats->time_to_setpoint_s) && (r->temperature >= stats->setpoint))
+        {
+            stats->time_to_setpoint_s = getSeconds(records, stats->first, i);
+        }
+
+        if ((0 <= stats->time_to_setpoint_s) && ((r->temperature - stats->setpoint) > stats->overshoot))
+        {
+            stats->overshoot = r->temperature - stats->setpoint;
+        }
+    }
+
+    stats->mean_duty = (0 < stats->duration_s) ? (100.0 * duty_s / stats->duration_s) : 0;
+    stats->energy_wh = duty_s * heater_watts / 3600.0;
+}
+
+// public:
+size_t findSessions(const SRecords *records, double heater_watts, SSessionStats *sessions, size_t max)
+{
+    size_t count = 0;
+    size_t i     = 0;
+
+    while ((i < records->count) && (count < max))
+    {
+        if (!records->records[i].fan)
+        {
+            i++;
+            continue;
+        }
+
+        SSessionStats *stats = &sessions[count++];
+
+        memset(stats, 0, sizeof(SSessionStats));
+        stats->first = i;
+
+        while ((i < records->count) && records->records[i].fan)
+        {
+            i++;
+        }
+
+        stats->last = i - 1;
+        analyseSession(records, heater_watts, stats);
+    }
+
+    return count;
+}
+
+// public:
+void printSessionStats(const SSessionStats *stats, size_t index)
+{
+    printf("session %zu: records %zu..%zu\n", index, stats->first, stats->last);
+    printf("  duration          %.0f s (%.2f h)\n", stats->duration_s, stats->duration_s / 3600);
+    printf("  setpoint          %u C\n", stats->setpoint);
+
+    if (0 <= stats->time_to_setpoint_s)
+    {
+        printf("  time to setpoint  %.0f s\n", stats->time_to_setpoint_s);
+        printf("  overshoot         %d C\n", stats->overshoot);
+    }
+    else
+    {
+        printf("  time to setpoint  not reached\n");
+    }
+
+    printf("  humidity          %.0f %% -> %.0f %%\n", stats->rh_start, stats->rh_end);
+
+    if (0 < stats->rh_tau_s)
+    {
+        printf("  RH decay tau      %.0f s\n", stats->rh_tau_s);
+    }
+    else
+    {
+        printf("  RH decay tau      n/a\n");
+    }
+
+    printf("  heater duty       %.1f %%\n", stats->mean_duty);
+    printf("  energy            %.1f Wh\n", stats->energy_wh);
+    printf("  faults            0x%02X%s%s%s%s\n", stats->faults,
+           (stats->faults & FAULT_FLAG_SENSOR) ? " sensor" : "",
+           (stats->faults & FAULT_FLAG_NTC)    ? " ntc"    : "",
+           (stats->faults & FAULT_FLAG_OUTPUT) ? " output" : "",
+           (stats->faults & FAULT_FLAG_SAFETY) ? " safety" : "");
+}
@@ -0,0 +1,29 @@
+/************************************************************************************************
+ * Session analysis:
+ ************************************************************************************************/
+
+#pragma once
+
+#include "decoder.h"
+
+// A session is a run of records with the fan on (the fan runs whenever the dryer is on)
+typedef struct
+{
+    size_t   first;
+    size_t   last;
+    double   duration_s;
+    uint8_t  setpoint;          // at the session start
+    double   time_to_setpoint_s; // < 0 - setpoint was not reached
+    int      overshoot;          // max temperature above setpoint after reaching it, degC
+    double   rh_start;
+    double   rh_end;
+    double   rh_tau_s;           // RH decay time constant, < 0 - not enough data
+    double   mean_duty;          // %
+    double   energy_wh;          // duty x heater power
+    uint8_t  faults;             // all fault flags seen
+} SSessionStats;
+
+// Returns count of sessions written to sessions, up to max
+size_t findSessions(const SRecords *records, double heater_watts, SSessionStats *sessions, size_t max);
+
+void printSessionStats(const SSessionStats *stats, size_t index);
@@ -0,0 +1,210 @@
+/************************************************************************************************
+ * Telemetry decoder:
+ ************************************************************************************************/
+
+#include "decoder.h"
+
+#include <protocol.h>
+#include <crc16.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+    PARSER_SOF,
+    PARSER_TYPE,
+    PARSER_LENGTH,
+    PARSER_PAYLOAD,
+    PARSER_CRC_LOW,
+    PARSER_CRC_HIGH,
+} EParserState;
+
+// private:
+void setField(SRecord *record, uint8_t field, uint8_t value)
+{
+    switch (field)
+    {
+        case TELEMETRY_TEMPERATURE: record->temperature = (int8_t)value; break;
+        case TELEMETRY_HUMIDITY:    record->humidity    = value;         break;
+        case TELEMETRY_HEATER_TEMP: record->heater_temp = (int8_t)value; break;
+        case TELEMETRY_HEATER_DUTY: record->heater_duty = value;         break;
+        case TELEMETRY_FAN:         record->fan         = value;         break;
+        case TELEMETRY_SETPOINT:    record->setpoint    = value;         break;
+        case TELEMETRY_FAULTS:      record->faults      = value;         break;
+        default:                                                         break;
+    }
+}
+
+// private:
+void handleFrame(SDecoder *this, SRecords *records)
+{
+    const uint8_t *p = this->payload;
+
+    this->frames++;
+
+    if (FRAME_TELEMETRY_KEY == this->type)
+    {
+        if ((4 + TELEMETRY_FIELDS_COUNT) != this->size)
+        {
+            return;
+        }
+
+        this->last.time_ms = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+        for (uint8_t i = 0; i < TELEMETRY_FIELDS_COUNT; i++)
+        {
+            setField(&this->last, i, p[4 + i]);
+        }
+
+        this->synced = true;
+        appendRecord(records, &this->last);
+    }
+    else if (FRAME_TELEMETRY_DELTA == this->type)
+    {
+        if (!this->synced || (3 > this->size))
+        {
+            this->deltas_dropped++;
+            return;
+        }
+
+        uint8_t mask = p[2];
+        uint8_t pos  = 3;
+
+        this->last.time_ms += p[0] | (p[1] << 8);
+
+        for (uint8_t i = 0; i < TELEMETRY_FIELDS_COUNT; i++)
+        {
+            if (mask & (1 << i))
+            {
+                if (this->size <= pos)
+                {
+                    // malformed, wait for the next key frame
+                    this->synced = false;
+                    return;
+                }
+                setField(&this->last, i, p[pos++]);
+            }
+        }
+
+        appendRecord(records, &this->last);
+    }
+    else if (FRAME_BOOT == this->type)
+    {
+        if (9 != this->size)
+        {
+            return;
+        }
+
+        this->boot_first_frame_us = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        this->boot_control_us     = p[4] | (p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        this->boot_reset_cause    = p[8];
+        this->boots++;
+
+        // the firmware has restarted, its telemetry clock with it
+        this->synced = false;
+    }
+    else
+    {
+        // command responses are not part of the telemetry stream
+    }
+}
+
+// public:
+void initDecoder(SDecoder *this)
+{
+    memset(this, 0, sizeof(SDecoder));
+    this->state = PARSER_SOF;
+}
+
+// public:
+void decodeBytes(SDecoder *this, const uint8_t *data, size_t size, SRecords *records)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t byte = data[i];
+
+        switch (this->state)
+        {
+            case PARSER_SOF:
+                if (PROTOCOL_SOF == byte)
+                {
+                    this->state = PARSER_TYPE;
+                }
+                break;
+
+            case PARSER_TYPE:
+                this->type  = byte;
+                this->crc   = updateCRC16(CRC16_INIT, byte);
+                this->state = PARSER_LENGTH;
+                break;
+
+            case PARSER_LENGTH:
+                this->size  = byte;
+                this->pos   = 0;
+                this->crc   = updateCRC16(this->crc, byte);
+                this->state = (0 == byte) ? PARSER_CRC_LOW : PARSER_PAYLOAD;
+                break;
+
+            case PARSER_PAYLOAD:
+                this->payload[this->pos++] = byte;
+                this->crc = updateCRC16(this->crc, byte);
+
+                if (this->size == this->pos)
+                {
+                    this->state = PARSER_CRC_LOW;
+                }
+                break;
+
+            case PARSER_CRC_LOW:
+                if ((uint8_t)this->crc == byte)
+                {
+                    this->state = PARSER_CRC_HIGH;
+                }
+                else
+                {
+                    this->crc_errors++;
+                    this->synced = false;
+                    this->state  = PARSER_SOF;
+                }
+                break;
+
+            default:
+                if ((uint8_t)(this->crc >> 8) == byte)
+                {
+                    handleFrame(this, records);
+                }
+                else
+                {
+                    this->crc_errors++;
+                    this->synced = false;
+                }
+                this->state = PARSER_SOF;
+                break;
+        }
+    }
+}
+
+// public:
+void appendRecord(SRecords *records, const SRecord *record)
+{
+    if (records->count == records->capacity)
+    {
+        records->capacity = (0 == records->capacity) ? 1024 : (records->capacity * 2);
+        records->records  = realloc(records->records, records->capacity * sizeof(SRecord));
+
+        if (NULL == records->records)
+        {
+            abort();
+        }
+    }
+
+    records->records[records->count++] = *record;
+}
+
+// public:
+void freeRecords(SRecords *records)
+{
+    free(records->records);
+    memset(records, 0, sizeof(SRecords));
+}
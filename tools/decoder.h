@@ -0,0 +1,62 @@
+/************************************************************************************************
+ * Telemetry decoder:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct
+{
+    uint32_t time_ms;
+    int8_t   temperature;
+    uint8_t  humidity;
+    int8_t   heater_temp;
+    uint8_t  heater_duty;
+    uint8_t  fan;
+    uint8_t  setpoint;
+    uint8_t  faults;
+} SRecord;
+
+typedef struct
+{
+    SRecord *records;
+    size_t   count;
+    size_t   capacity;
+} SRecords;
+
+typedef struct
+{
+    // parser:
+    uint8_t  state;
+    uint8_t  type;
+    uint8_t  size;
+    uint8_t  pos;
+    uint16_t crc;
+    uint8_t  payload[256];
+
+    // telemetry state, deltas apply to it only after a key frame:
+    bool     synced;
+    SRecord  last;
+
+    // last FRAME_BOOT:
+    uint32_t boot_first_frame_us;
+    uint32_t boot_control_us;
+    uint8_t  boot_reset_cause;
+
+    // counters:
+    size_t   boots;
+    size_t   frames;
+    size_t   crc_errors;
+    size_t   deltas_dropped;
+} SDecoder;
+
+void initDecoder(SDecoder *this);
+
+// Feeds bytes, decoded records are appended to records
+void decodeBytes(SDecoder *this, const uint8_t *data, size_t size, SRecords *records);
+
+void appendRecord(SRecords *records, const SRecord *record);
+void freeRecords(SRecords *records);
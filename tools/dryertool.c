@@ -0,0 +1,391 @@
+/************************************************************************************************
+ * Dryer tool: records, decodes and analyses telemetry of the dryer.
+ *
+ *  dryertool record <tty> <capture>          - saves raw UART bytes, prints records live
+ *  dryertool decode <input> [-c csv] [-b bin] - converts to CSV and/or columnar binary
+ *  dryertool stats  <input> [-w watts]        - per session summary
+ *  dryertool plot   <input> [-g gp -c csv] [-x width] [-y height]
+ *                                             - ASCII plot, or gnuplot script and its data
+ *  dryertool synth  <capture> [-t hours] [-s setpoint]
+ *                                             - simulated session through the firmware encoder
+ *  dryertool modbus [-v]                      - Modbus master simulator against the firmware slave
+ *
+ * <input> is a raw capture or a binary session file written by decode -b.
+ ************************************************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include "decoder.h"
+#include "storage.h"
+#include "analysis.h"
+#include "plot.h"
+#include "master.h"
+#include "uart_host.h"
+
+#include <telemetry.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SESSIONS_MAX         64
+#define DEFAULT_HEATER_WATTS 150
+
+typedef struct
+{
+    const char *csv;
+    const char *bin;
+    const char *gnuplot;
+    double      watts;
+    double      hours;
+    int         setpoint;
+    int         width;
+    int         height;
+} SOptions;
+
+volatile sig_atomic_t stop_requested = 0;
+
+void handleSignal(int signal)
+{
+    (void)signal;
+    stop_requested = 1;
+}
+
+void printUsage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  dryertool record <tty> <capture>\n"
+            "  dryertool decode <input> [-c csv] [-b bin]\n"
+            "  dryertool stats  <input> [-w watts]\n"
+            "  dryertool plot   <input> [-g gnuplot_script -c csv] [-x width] [-y height]\n"
+            "  dryertool synth  <capture> [-t hours] [-s setpoint]\n"
+            "  dryertool modbus [-v]\n");
+}
+
+bool parseOptions(int argc, char **argv, int first, SOptions *options)
+{
+    memset(options, 0, sizeof(SOptions));
+    options->watts    = DEFAULT_HEATER_WATTS;
+    options->hours    = 4;
+    options->setpoint = 55;
+    options->width    = 72;
+    options->height   = 20;
+
+    for (int i = first; i < argc; i++)
+    {
+        if ((argc <= (i + 1)) || ('-' != argv[i][0]) || (0 == argv[i][1]) || (0 != argv[i][2]))
+        {
+            fprintf(stderr, "bad option: %s\n", argv[i]);
+            return false;
+        }
+
+        const char *value = argv[++i];
+
+        switch (argv[i - 1][1])
+        {
+            case 'c': options->csv      = value;       break;
+            case 'b': options->bin      = value;       break;
+            case 'g': options->gnuplot  = value;       break;
+            case 'w': options->watts    = atof(value); break;
+            case 't': options->hours    = atof(value); break;
+            case 's': options->setpoint = atoi(value); break;
+            case 'x': options->width    = atoi(value); break;
+            case 'y': options->height   = atoi(value); break;
+
+            default:
+                fprintf(stderr, "unknown option: %s\n", argv[i - 1]);
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void printBootTimes(const SDecoder *decoder)
+{
+    if (0 != decoder->boots)
+    {
+        fprintf(stderr, "%zu boots, last: first frame %.1f ms, control active %.1f ms, reset cause %u\n",
+                decoder->boots, decoder->boot_first_frame_us / 1000.0,
+                decoder->boot_control_us / 1000.0, decoder->boot_reset_cause);
+    }
+}
+
+bool loadInput(const char *path, SRecords *records)
+{
+    if (isSessionFile(path))
+    {
+        return readSessionFile(path, records);
+    }
+
+    SDecoder decoder;
+
+    initDecoder(&decoder);
+
+    if (!readCaptureFile(path, &decoder, records))
+    {
+        return false;
+    }
+
+    fprintf(stderr, "%zu frames, %zu records, %zu crc errors, %zu deltas without key frame\n",
+            decoder.frames, records->count, decoder.crc_errors, decoder.deltas_dropped);
+    printBootTimes(&decoder);
+    return true;
+}
+
+void printRecord(const SRecord *r)
+{
+    printf("%10.1f s  T %3d C  RH %3u %%  NTC %3d C  duty %3u %%  fan %u  set %3u C  faults 0x%02X\n",
+           r->time_ms / 1000.0, r->temperature, r->humidity, r->heater_temp, r->heater_duty,
+           r->fan, r->setpoint, r->faults);
+}
+
+int openSerial(const char *path)
+{
+    int            fd = open(path, O_RDONLY | O_NOCTTY);
+    struct termios tty;
+
+    if (0 > fd)
+    {
+        return -1;
+    }
+
+    if (0 != tcgetattr(fd, &tty))
+    {
+        close(fd);
+        return -1;
+    }
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B57600); // PROTOCOL_BAUDRATE
+    tty.c_cc[VMIN]  = 1;
+    tty.c_cc[VTIME] = 0;
+
+    if (0 != tcsetattr(fd, TCSANOW, &tty))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int record(const char *tty, const char *capture)
+{
+    int      fd   = openSerial(tty);
+    FILE    *file = fopen(capture, "wb");
+    SDecoder decoder;
+    SRecords records;
+
+    if ((0 > fd) || (NULL == file))
+    {
+        fprintf(stderr, "can't open %s or %s: %s\n", tty, capture, strerror(errno));
+        return 1;
+    }
+
+    memset(&records, 0, sizeof(records));
+    initDecoder(&decoder);
+    signal(SIGINT, handleSignal);
+
+    while (!stop_requested)
+    {
+        uint8_t buffer[256];
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+
+        if (0 >= size)
+        {
+            if ((0 > size) && (EINTR != errno))
+            {
+                break;
+            }
+            continue;
+        }
+
+        fwrite(buffer, 1, size, file);
+        fflush(file);
+
+        size_t first = records.count;
+
+        decodeBytes(&decoder, buffer, size, &records);
+
+        for (size_t i = first; i < records.count; i++)
+        {
+            printRecord(&records.records[i]);
+        }
+    }
+
+    fprintf(stderr, "%zu records, %zu crc errors\n", records.count, decoder.crc_errors);
+    printBootTimes(&decoder);
+
+    close(fd);
+    fclose(file);
+    freeRecords(&records);
+    return 0;
+}
+
+// Simple thermal model driven by the same bang-bang control as the firmware
+int synth(const char *capture, const SOptions *options)
+{
+    FILE *file = fopen(capture, "wb");
+
+    if (NULL == file)
+    {
+        fprintf(stderr, "can't open %s: %s\n", capture, strerror(errno));
+        return 1;
+    }
+
+    setUARTFile(file);
+
+    double chamber = 22;
+    double heater  = 22;
+    double rh      = 60;
+    bool   on      = false;
+    int    seconds = (int)(options->hours * 3600);
+
+    for (int s = 0; s < (seconds + 60); s++)
+    {
+        bool fan = (s < seconds);
+
+        // heater decision as in the firmware 1 s loop
+        on = fan && (chamber < options->setpoint) && (heater < (options->setpoint + 40));
+
+        heater  += (on ? 1.2 : 0) - (heater - chamber) * 0.02;
+        chamber += (heater - chamber) * 0.004 - (chamber - 22) * 0.0015;
+        rh      += (10 - rh) / 2400.0 + ((s % 97) ? 0 : 0.3);
+
+        STelemetrySample sample;
+
+        sample.temperature = (int8_t)chamber;
+        sample.humidity    = (uint8_t)(rh + 0.5);
+        sample.heater_temp = (int8_t)heater;
+        sample.heater_on   = on;
+        sample.fan_on      = fan;
+        sample.setpoint    = options->setpoint;
+        sample.faults      = 0;
+
+        handleTelemetrySecond((uint32_t)s * 1000, &sample);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    SOptions options;
+    SRecords records;
+
+    memset(&records, 0, sizeof(records));
+
+    if ((2 <= argc) && (0 == strcmp(argv[1], "modbus")))
+    {
+        bool verbose = (3 == argc) && (0 == strcmp(argv[2], "-v"));
+
+        return (0 == runModbusLoopback(verbose)) ? 0 : 1;
+    }
+
+    if (3 > argc)
+    {
+        printUsage();
+        return 2;
+    }
+
+    const char *command = argv[1];
+
+    if (0 == strcmp(command, "record"))
+    {
+        if (4 != argc)
+        {
+            printUsage();
+            return 2;
+        }
+        return record(argv[2], argv[3]);
+    }
+
+    if (!parseOptions(argc, argv, 3, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    if (0 == strcmp(command, "synth"))
+    {
+        return synth(argv[2], &options);
+    }
+
+    if (!loadInput(argv[2], &records))
+    {
+        fprintf(stderr, "can't read %s\n", argv[2]);
+        return 1;
+    }
+
+    int result = 0;
+
+    if (0 == strcmp(command, "decode"))
+    {
+        if ((NULL == options.csv) && (NULL == options.bin))
+        {
+            for (size_t i = 0; i < records.count; i++)
+            {
+                printRecord(&records.records[i]);
+            }
+        }
+
+        if ((NULL != options.csv) && !writeCsv(options.csv, &records))
+        {
+            fprintf(stderr, "can't write %s\n", options.csv);
+            result = 1;
+        }
+
+        if ((NULL != options.bin) && !writeSessionFile(options.bin, &records))
+        {
+            fprintf(stderr, "can't write %s\n", options.bin);
+            result = 1;
+        }
+    }
+    else if (0 == strcmp(command, "stats"))
+    {
+        SSessionStats sessions[SESSIONS_MAX];
+        size_t        count = findSessions(&records, options.watts, sessions, SESSIONS_MAX);
+
+        if (0 == count)
+        {
+            printf("no sessions\n");
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            printSessionStats(&sessions[i], i);
+        }
+    }
+    else if (0 == strcmp(command, "plot"))
+    {
+        if (NULL != options.gnuplot)
+        {
+            if ((NULL == options.csv) || !writeCsv(options.csv, &records) ||
+                !writeGnuplotScript(options.gnuplot, options.csv))
+            {
+                fprintf(stderr, "gnuplot output needs -c <csv>, and both files writable\n");
+                result = 1;
+            }
+        }
+        else
+        {
+            plotAscii(&records, options.width, options.height);
+        }
+    }
+    else
+    {
+        printUsage();
+        result = 2;
+    }
+
+    freeRecords(&records);
+    return result;
+}
@@ -0,0 +1,11 @@
+/************************************************************************************************
+ * Minimal stm8s.h for building firmware modules on the host:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// Only what utilities.h refers to
+typedef struct GPIO_struct GPIO_TypeDef;
+typedef uint8_t GPIO_Pin_TypeDef;
@@ -0,0 +1,248 @@
+/************************************************************************************************
+ * Modbus master simulator:
+ ************************************************************************************************/
+
+#include "master.h"
+#include "uart_host.h"
+
+#include <modbus.h>
+#include <crc16.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SLAVE_ADDRESS 17
+#define FRAME_MAX     256
+
+typedef struct
+{
+    uint8_t data[FRAME_MAX];
+    size_t  size;
+} SFrame;
+
+// Register map of the slave under test
+uint8_t  slave_u8       = 200;
+int8_t   slave_s8       = -5;
+uint16_t slave_u16      = 0x1234;
+uint32_t slave_u32      = 0xCAFEF00D;
+uint16_t slave_written  = 0;
+uint8_t  slave_writes   = 0;
+
+bool writeSlaveU16(uint16_t value)
+{
+    if (1000 < value)
+    {
+        return false;
+    }
+
+    slave_written = value;
+    slave_writes++;
+    return true;
+}
+
+const SModbusRegister slave_inputs[] =
+{
+    {&slave_u8,  MODBUS_U8,       0},
+    {&slave_s8,  MODBUS_S8,       0},
+    {&slave_u32, MODBUS_U32_HIGH, 0},
+    {&slave_u32, MODBUS_U32_LOW,  0},
+};
+
+const SModbusRegister slave_holdings[] =
+{
+    {&slave_written, MODBUS_U16, writeSlaveU16},
+    {&slave_u16,     MODBUS_U16, 0},
+    {&slave_written, MODBUS_U16, writeSlaveU16},
+};
+
+int failures = 0;
+bool verbose_output = false;
+
+void check(bool condition, const char *name)
+{
+    if (!condition)
+    {
+        failures++;
+    }
+
+    if (!condition || verbose_output)
+    {
+        printf("%-40s %s\n", name, condition ? "ok" : "FAILED");
+    }
+}
+
+void addCRC(SFrame *frame)
+{
+    uint16_t crc = calcCRC16(frame->data, (uint8_t)frame->size);
+
+    frame->data[frame->size++] = (uint8_t)crc;
+    frame->data[frame->size++] = (uint8_t)(crc >> 8);
+}
+
+void buildRequest(SFrame *frame, uint8_t address, uint8_t function, uint16_t first,
+                  uint16_t value)
+{
+    frame->size = 0;
+    frame->data[frame->size++] = address;
+    frame->data[frame->size++] = function;
+    frame->data[frame->size++] = first >> 8;
+    frame->data[frame->size++] = (uint8_t)first;
+    frame->data[frame->size++] = value >> 8;
+    frame->data[frame->size++] = (uint8_t)value;
+    addCRC(frame);
+}
+
+// Sends the request followed by the t3.5 gap, returns the slave output
+void transact(const SFrame *request, SFrame *response)
+{
+    FILE *file = tmpfile();
+
+    setUARTFile(file);
+
+    for (size_t i = 0; i < request->size; i++)
+    {
+        receiveModbusByte(request->data[i]);
+    }
+
+    endModbusFrame();
+    handleModbus();
+
+    rewind(file);
+    response->size = fread(response->data, 1, FRAME_MAX, file);
+
+    setUARTFile(NULL);
+    fclose(file);
+}
+
+bool isValidResponse(const SFrame *response, uint8_t function)
+{
+    if ((4 > response->size) || (SLAVE_ADDRESS != response->data[0]) ||
+        (function != response->data[1]))
+    {
+        return false;
+    }
+
+    uint16_t crc = calcCRC16(response->data, (uint8_t)(response->size - 2));
+
+    return ((uint8_t)crc == response->data[response->size - 2]) &&
+           ((uint8_t)(crc >> 8) == response->data[response->size - 1]);
+}
+
+bool isException(const SFrame *response, uint8_t function, uint8_t code)
+{
+    return isValidResponse(response, function | 0x80) && (5 == response->size) &&
+           (code == response->data[2]);
+}
+
+uint16_t getRegister(const SFrame *response, size_t index)
+{
+    return ((uint16_t)response->data[3 + 2 * index] << 8) | response->data[4 + 2 * index];
+}
+
+// public:
+int runModbusLoopback(bool verbose)
+{
+    SFrame request;
+    SFrame response;
+
+    failures       = 0;
+    verbose_output = verbose;
+
+    initModbus(SLAVE_ADDRESS,
+               slave_inputs,   sizeof(slave_inputs)/sizeof(SModbusRegister),
+               slave_holdings, sizeof(slave_holdings)/sizeof(SModbusRegister));
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x04, 0, 4);
+    transact(&request, &response);
+    check(isValidResponse(&response, 0x04) && (13 == response.size) && (8 == response.data[2]) &&
+          (200 == getRegister(&response, 0)) && (0xFFFB == getRegister(&response, 1)) &&
+          (0xCAFE == getRegister(&response, 2)) && (0xF00D == getRegister(&response, 3)),
+          "read input registers");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x03, 1, 1);
+    transact(&request, &response);
+    check(isValidResponse(&response, 0x03) && (0x1234 == getRegister(&response, 0)),
+          "read holding register");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x04, 3, 2);
+    transact(&request, &response);
+    check(isException(&response, 0x04, 0x02), "read past the map");
+
+    // first + quantity wraps to 0 in 16 bit arithmetic of the target
+    buildRequest(&request, SLAVE_ADDRESS, 0x04, 0xFFFF, 1);
+    transact(&request, &response);
+    check(isException(&response, 0x04, 0x02), "read at the last address");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x03, 0, MODBUS_READ_MAX + 1);
+    transact(&request, &response);
+    check(isException(&response, 0x03, 0x03), "read too many registers");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x06, 0, 500);
+    transact(&request, &response);
+    check((response.size == request.size) &&
+          (0 == memcmp(response.data, request.data, request.size)) && (500 == slave_written),
+          "write single register echo");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x06, 0, 2000);
+    transact(&request, &response);
+    check(isException(&response, 0x06, 0x03) && (500 == slave_written), "write illegal value");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x06, 1, 1);
+    transact(&request, &response);
+    check(isException(&response, 0x06, 0x02) && (0x1234 == slave_u16), "write read-only register");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x06, 0xFFFF, 1);
+    transact(&request, &response);
+    check(isException(&response, 0x06, 0x02) && (500 == slave_written), "write at the last address");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x05, 0, 0xFF00);
+    transact(&request, &response);
+    check(isException(&response, 0x05, 0x01), "unsupported function");
+
+    // registers 0 and 2 are writable, 1 is not
+    memcpy(request.data, (const uint8_t[]){SLAVE_ADDRESS, 0x10, 0, 2, 0, 1, 2, 0, 42}, 9);
+    request.size = 9;
+    addCRC(&request);
+    slave_writes = 0;
+    transact(&request, &response);
+    check(isValidResponse(&response, 0x10) && (8 == response.size) && (2 == response.data[3]) &&
+          (1 == response.data[5]) && (42 == slave_written) &&
+          (1 == slave_writes), "write multiple registers");
+
+    memcpy(request.data, (const uint8_t[]){SLAVE_ADDRESS, 0x10, 0, 0, 0, 2, 4, 0, 1, 0, 2}, 11);
+    request.size = 11;
+    addCRC(&request);
+    slave_writes = 0;
+    transact(&request, &response);
+    check(isException(&response, 0x10, 0x02) && (0 == slave_writes),
+          "write multiple over read-only register");
+
+    buildRequest(&request, SLAVE_ADDRESS, 0x03, 1, 1);
+    request.data[request.size - 1] ^= 0x01;
+    transact(&request, &response);
+    check(0 == response.size, "bad CRC is ignored");
+
+    buildRequest(&request, SLAVE_ADDRESS + 1, 0x03, 1, 1);
+    transact(&request, &response);
+    check(0 == response.size, "other slave address is ignored");
+
+    buildRequest(&request, 0, 0x06, 2, 7);
+    transact(&request, &response);
+    check((0 == response.size) && (7 == slave_written), "broadcast write, no response");
+
+    memset(request.data, 0x55, MODBUS_FRAME_MAX + 8);
+    request.size = MODBUS_FRAME_MAX + 8;
+    transact(&request, &response);
+    check(0 == response.size, "overlong frame is dropped");
+
+    // the slave recovers after the garbage
+    buildRequest(&request, SLAVE_ADDRESS, 0x03, 1, 1);
+    transact(&request, &response);
+    check(isValidResponse(&response, 0x03) && (0x1234 == getRegister(&response, 0)),
+          "recovery after dropped frame");
+
+    printf("modbus loopback: %d failed\n", failures);
+
+    return failures;
+}
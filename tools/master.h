@@ -0,0 +1,12 @@
+/************************************************************************************************
+ * Modbus master simulator:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+
+// Runs the firmware Modbus slave in-process against a register map of host variables. Requests
+// are fed byte by byte to the slave, responses are taken from the UART replacement and checked.
+// Returns number of failed checks.
+int runModbusLoopback(bool verbose);
@@ -0,0 +1,114 @@
+/************************************************************************************************
+ * Plots:
+ ************************************************************************************************/
+
+#include "plot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// private:
+void putPoint(char *canvas, int width, int height, int x, int value, int min, int max, char c)
+{
+    int y = (max == min) ? 0 : ((value - min) * (height - 1) / (max - min));
+
+    if ((0 > y) || (height <= y))
+    {
+        return;
+    }
+
+    canvas[(height - 1 - y) * width + x] = c;
+}
+
+// public:
+void plotAscii(const SRecords *records, int width, int height)
+{
+    if (0 == records->count)
+    {
+        printf("no records\n");
+        return;
+    }
+
+    int min = 0;
+    int max = 0;
+
+    for (size_t i = 0; i < records->count; i++)
+    {
+        const SRecord *r = &records->records[i];
+        int values[4] = {r->temperature, r->humidity, r->heater_temp, r->setpoint};
+
+        for (int v = 0; v < 4; v++)
+        {
+            if (values[v] < min) min = values[v];
+            if (values[v] > max) max = values[v];
+        }
+    }
+
+    char *canvas = malloc(width * height);
+
+    memset(canvas, ' ', width * height);
+
+    uint32_t t0   = records->records[0].time_ms;
+    uint32_t span = records->records[records->count - 1].time_ms - t0;
+
+    // later series are drawn over earlier ones
+    for (size_t i = 0; i < records->count; i++)
+    {
+        const SRecord *r = &records->records[i];
+        int x = (0 == span) ? 0 : (int)((uint64_t)(r->time_ms - t0) * (width - 1) / span);
+
+        putPoint(canvas, width, height, x, r->setpoint,    min, max, '-');
+        putPoint(canvas, width, height, x, r->heater_temp, min, max, 'N');
+        putPoint(canvas, width, height, x, r->humidity,    min, max, 'H');
+        putPoint(canvas, width, height, x, r->temperature, min, max, 'T');
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        int value = max - (max - min) * y / ((1 < height) ? (height - 1) : 1);
+
+        printf("%4d |%.*s\n", value, width, &canvas[y * width]);
+    }
+
+    printf("     +");
+    for (int x = 0; x < width; x++)
+    {
+        putchar('-');
+    }
+    printf("\n      0 s%*s%.0f s\n", width - 12, "", span / 1000.0);
+    printf("      T - chamber temperature, H - humidity, N - heater NTC, - setpoint\n");
+
+    free(canvas);
+}
+
+// public:
+bool writeGnuplotScript(const char *path, const char *csv_path)
+{
+    FILE *file = fopen(path, "w");
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    fprintf(file,
+            "set datafile separator ','\n"
+            "set key autotitle columnhead\n"
+            "set xlabel 'time, h'\n"
+            "set ylabel 'C / %%RH'\n"
+            "set y2label 'heater duty, %%'\n"
+            "set y2range [0:100]\n"
+            "set ytics nomirror\n"
+            "set y2tics\n"
+            "set grid\n"
+            "plot '%s' using ($1/3600):2 with lines, \\\n"
+            "     '' using ($1/3600):3 with lines, \\\n"
+            "     '' using ($1/3600):4 with lines, \\\n"
+            "     '' using ($1/3600):7 with lines dashtype 2, \\\n"
+            "     '' using ($1/3600):5 with steps axes x1y2\n"
+            "pause mouse close\n",
+            csv_path);
+
+    return 0 == fclose(file);
+}
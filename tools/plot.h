@@ -0,0 +1,13 @@
+/************************************************************************************************
+ * Plots:
+ ************************************************************************************************/
+
+#pragma once
+
+#include "decoder.h"
+
+// Draws temperature (T), humidity (H), heater temperature (N) and setpoint (-) to stdout
+void plotAscii(const SRecords *records, int width, int height);
+
+// Writes gnuplot script which plots the CSV written by writeCsv()
+bool writeGnuplotScript(const char *path, const char *csv_path);
@@ -0,0 +1,189 @@
+/************************************************************************************************
+ * Session files:
+ ************************************************************************************************/
+
+#include "storage.h"
+
+#include <protocol.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// private:
+bool writeU32(FILE *file, uint32_t value)
+{
+    uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+
+    return 1 == fwrite(bytes, sizeof(bytes), 1, file);
+}
+
+// private:
+bool readU32(FILE *file, uint32_t *value)
+{
+    uint8_t bytes[4];
+
+    if (1 != fread(bytes, sizeof(bytes), 1, file))
+    {
+        return false;
+    }
+
+    *value = bytes[0] | (bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return true;
+}
+
+// private:
+// Byte column accessor: field of the record by telemetry field index
+uint8_t* getField(SRecord *record, uint8_t field)
+{
+    switch (field)
+    {
+        case TELEMETRY_TEMPERATURE: return (uint8_t*)&record->temperature;
+        case TELEMETRY_HUMIDITY:    return &record->humidity;
+        case TELEMETRY_HEATER_TEMP: return (uint8_t*)&record->heater_temp;
+        case TELEMETRY_HEATER_DUTY: return &record->heater_duty;
+        case TELEMETRY_FAN:         return &record->fan;
+        case TELEMETRY_SETPOINT:    return &record->setpoint;
+        default:                    return &record->faults;
+    }
+}
+
+// public:
+bool writeCsv(const char *path, const SRecords *records)
+{
+    FILE *file = fopen(path, "w");
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    fprintf(file, "time_s,temperature,humidity,heater_temp,heater_duty,fan,setpoint,faults\n");
+
+    for (size_t i = 0; i < records->count; i++)
+    {
+        const SRecord *r = &records->records[i];
+
+        fprintf(file, "%.3f,%d,%u,%d,%u,%u,%u,%u\n", r->time_ms / 1000.0, r->temperature,
+                r->humidity, r->heater_temp, r->heater_duty, r->fan, r->setpoint, r->faults);
+    }
+
+    return 0 == fclose(file);
+}
+
+// public:
+bool writeSessionFile(const char *path, const SRecords *records)
+{
+    FILE *file = fopen(path, "wb");
+    bool  ok   = true;
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    uint8_t header[2] = {SESSION_VERSION, 1 + TELEMETRY_FIELDS_COUNT};
+
+    ok = ok && (1 == fwrite(SESSION_MAGIC, 4, 1, file));
+    ok = ok && (1 == fwrite(header, sizeof(header), 1, file));
+    ok = ok && writeU32(file, (uint32_t)records->count);
+
+    for (size_t i = 0; ok && (i < records->count); i++)
+    {
+        ok = writeU32(file, records->records[i].time_ms);
+    }
+
+    for (uint8_t field = 0; ok && (field < TELEMETRY_FIELDS_COUNT); field++)
+    {
+        for (size_t i = 0; ok && (i < records->count); i++)
+        {
+            ok = (EOF != fputc(*getField(&records->records[i], field), file));
+        }
+    }
+
+    return (0 == fclose(file)) && ok;
+}
+
+// public:
+bool isSessionFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    char  magic[4];
+    bool  result;
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    result = (1 == fread(magic, sizeof(magic), 1, file)) && (0 == memcmp(magic, SESSION_MAGIC, 4));
+
+    fclose(file);
+    return result;
+}
+
+// public:
+bool readSessionFile(const char *path, SRecords *records)
+{
+    FILE    *file = fopen(path, "rb");
+    char     magic[4];
+    uint8_t  header[2];
+    uint32_t rows = 0;
+    bool     ok   = true;
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    ok = ok && (1 == fread(magic, sizeof(magic), 1, file)) && (0 == memcmp(magic, SESSION_MAGIC, 4));
+    ok = ok && (1 == fread(header, sizeof(header), 1, file));
+    ok = ok && (SESSION_VERSION == header[0]) && ((1 + TELEMETRY_FIELDS_COUNT) == header[1]);
+    ok = ok && readU32(file, &rows);
+
+    size_t first = records->count;
+    SRecord empty;
+
+    memset(&empty, 0, sizeof(empty));
+
+    for (uint32_t i = 0; ok && (i < rows); i++)
+    {
+        appendRecord(records, &empty);
+        ok = readU32(file, &records->records[first + i].time_ms);
+    }
+
+    for (uint8_t field = 0; ok && (field < TELEMETRY_FIELDS_COUNT); field++)
+    {
+        for (uint32_t i = 0; ok && (i < rows); i++)
+        {
+            int value = fgetc(file);
+
+            ok = (EOF != value);
+            *getField(&records->records[first + i], field) = (uint8_t)value;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+// public:
+bool readCaptureFile(const char *path, SDecoder *decoder, SRecords *records)
+{
+    FILE   *file = fopen(path, "rb");
+    uint8_t buffer[4096];
+    size_t  size;
+
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    while (0 != (size = fread(buffer, 1, sizeof(buffer), file)))
+    {
+        decodeBytes(decoder, buffer, size, records);
+    }
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,27 @@
+/************************************************************************************************
+ * Session files:
+ ************************************************************************************************/
+
+#pragma once
+
+#include "decoder.h"
+
+// Binary session file is columnar: header, then all values of each column one after another,
+// little-endian:
+//   "SVTL", version (1), columns (1), rows (4),
+//   time_ms[rows] (4 each), temperature[rows], humidity[rows], heater_temp[rows],
+//   heater_duty[rows], fan[rows], setpoint[rows], faults[rows] (1 each)
+// Columns of equal values compress well and a single column can be read without the others.
+
+#define SESSION_MAGIC   "SVTL"
+#define SESSION_VERSION 1
+
+bool writeCsv(const char *path, const SRecords *records);
+bool writeSessionFile(const char *path, const SRecords *records);
+
+// True if the file starts with SESSION_MAGIC
+bool isSessionFile(const char *path);
+bool readSessionFile(const char *path, SRecords *records);
+
+// Decodes raw bytes captured from the UART
+bool readCaptureFile(const char *path, SDecoder *decoder, SRecords *records);
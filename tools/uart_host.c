@@ -0,0 +1,37 @@
+/************************************************************************************************
+ * UART replacement for running the firmware telemetry encoder and Modbus slave on the host:
+ ************************************************************************************************/
+
+#include "uart_host.h"
+
+#include <uart.h>
+
+FILE *uart_file = NULL;
+
+// public:
+void setUARTFile(FILE *file)
+{
+    uart_file = file;
+}
+
+uint8_t getUARTFreeSpace()
+{
+    return UART_TX_BUFFER_SIZE - 1;
+}
+
+bool writeUART(const uint8_t *data, uint8_t size)
+{
+    return (NULL != uart_file) && (size == fwrite(data, 1, size, uart_file));
+}
+
+// The host feeds received bytes and gaps to the modules directly
+void setUARTReceiver(UARTReceiver receiver)
+{
+    (void)receiver;
+}
+
+void setUARTGapHandler(UARTGapHandler handler, uint16_t gap_us)
+{
+    (void)handler;
+    (void)gap_us;
+}
@@ -0,0 +1,10 @@
+/************************************************************************************************
+ * UART replacement for running the firmware telemetry encoder and Modbus slave on the host:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+
+// Bytes written by the firmware modules go to file
+void setUARTFile(FILE *file);
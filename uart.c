@@ -0,0 +1,187 @@
+/************************************************************************************************
+ * UART:
+ ************************************************************************************************/
+
+#include <uart.h>
+#include <clock.h>
+#include <utilities.h>
+
+#include <stm8s_clk.h>
+#include <stm8s_uart1.h>
+#include <stm8s_tim4.h>
+
+#define UART_TX_MASK (UART_TX_BUFFER_SIZE - 1)
+
+// TIM4 prescaler follows the clock, 8 us per tick
+#define UART_GAP_TICK_US 8
+
+const uint8_t uart_gap_prescalers[CLOCK_MODES_COUNT] = {TIM4_PRESCALER_128, TIM4_PRESCALER_16};
+
+uint8_t          uart_tx_buffer[UART_TX_BUFFER_SIZE];
+volatile uint8_t uart_tx_head = 0; // written by writeUART()
+volatile uint8_t uart_tx_tail = 0; // written by the TXE interrupt
+UARTReceiver     uart_receiver = 0;
+UARTGapHandler   uart_gap_handler = 0;
+uint8_t          uart_brr1[CLOCK_MODES_COUNT]; // baud rate registers for each clock mode
+uint8_t          uart_brr2[CLOCK_MODES_COUNT];
+volatile uint32_t uart_rx_ms      = 0; // last received byte
+
+// private:
+void setGapPrescaler(EClockMode mode)
+{
+    // load the prescaler now, the update event this generates must not call the handler
+    TIM4_PrescalerConfig((TIM4_Prescaler_TypeDef)uart_gap_prescalers[mode], TIM4_PSCRELOADMODE_IMMEDIATE);
+    TIM4_ClearFlag(TIM4_FLAG_UPDATE);
+}
+
+// private:
+void retuneUART(EClockMode mode)
+{
+    // BRR2 first, writing BRR1 updates the baud rate
+    UART1->BRR2 = uart_brr2[mode];
+    UART1->BRR1 = uart_brr1[mode];
+
+    if (0 != uart_gap_handler)
+    {
+        setGapPrescaler(mode);
+    }
+}
+
+// public:
+void initUART(uint32_t baudrate)
+{
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_UART1, ENABLE);
+
+    UART1_DeInit();
+    UART1_Init(baudrate, UART1_WORDLENGTH_8D, UART1_STOPBITS_1, UART1_PARITY_NO,
+               UART1_SYNCMODE_CLOCK_DISABLE, UART1_MODE_TXRX_ENABLE);
+    UART1_Cmd(ENABLE);
+
+    // the divisions are done here, a clock change only writes the registers
+    for (uint8_t mode = 0; mode < CLOCK_MODES_COUNT; mode++)
+    {
+        uint16_t divider = (getClockFrequency(mode) + baudrate / 2) / baudrate;
+
+        uart_brr2[mode] = (uint8_t)(((divider >> 8) & 0xF0) | (divider & 0x0F));
+        uart_brr1[mode] = (uint8_t)(divider >> 4);
+    }
+
+    addClockHandler(retuneUART);
+}
+
+// public:
+void setUARTReceiver(UARTReceiver receiver)
+{
+    uart_receiver = receiver;
+    UART1_ITConfig(UART1_IT_RXNE_OR, (0 != receiver) ? ENABLE : DISABLE);
+}
+
+// public:
+void setUARTGapHandler(UARTGapHandler handler, uint16_t gap_us)
+{
+    uint16_t ticks = gap_us / UART_GAP_TICK_US;
+
+    TIM4_Cmd(DISABLE);
+    TIM4_ITConfig(TIM4_IT_UPDATE, DISABLE);
+
+    uart_gap_handler = handler;
+
+    if (0 == handler)
+    {
+        return;
+    }
+
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_TIMER4, ENABLE);
+
+    TIM4_TimeBaseInit(TIM4_PRESCALER_1, (255 < ticks) ? 255 : (uint8_t)ticks);
+    TIM4_SelectOnePulseMode(TIM4_OPMODE_SINGLE);
+    setGapPrescaler(getClockMode());
+    TIM4_ITConfig(TIM4_IT_UPDATE, ENABLE);
+}
+
+// public:
+bool isUARTQuiet(uint16_t quiet_ms)
+{
+    uint32_t rx_ms;
+
+    CRITICAL
+    {
+        rx_ms = uart_rx_ms;
+    }
+
+    return (uart_tx_head == uart_tx_tail) && (SET == UART1_GetFlagStatus(UART1_FLAG_TC)) &&
+           ((getMillis() - rx_ms) >= quiet_ms);
+}
+
+// public:
+uint8_t getUARTFreeSpace()
+{
+    // one byte is kept free to tell full from empty
+    return UART_TX_MASK - ((uart_tx_head - uart_tx_tail) & UART_TX_MASK);
+}
+
+// public:
+bool writeUART(const uint8_t *data, uint8_t size)
+{
+    if (getUARTFreeSpace() < size)
+    {
+        return false;
+    }
+
+    uint8_t head = uart_tx_head;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        uart_tx_buffer[head] = data[i];
+        head = (head + 1) & UART_TX_MASK;
+    }
+
+    uart_tx_head = head;
+
+    UART1_ITConfig(UART1_IT_TXE, ENABLE);
+
+    return true;
+}
+
+INTERRUPT_HANDLER(UART1_TX_IRQHandler, 17)
+{
+    if (uart_tx_head == uart_tx_tail)
+    {
+        UART1_ITConfig(UART1_IT_TXE, DISABLE);
+        return;
+    }
+
+    UART1_SendData8(uart_tx_buffer[uart_tx_tail]);
+    uart_tx_tail = (uart_tx_tail + 1) & UART_TX_MASK;
+}
+
+INTERRUPT_HANDLER(UART1_RX_IRQHandler, 18)
+{
+    // reading of SR then DR clears both RXNE and overrun
+    UART1_GetFlagStatus(UART1_FLAG_OR);
+    uint8_t data = UART1_ReceiveData8();
+
+    uart_rx_ms = getMillis();
+
+    if (0 != uart_receiver)
+    {
+        uart_receiver(data);
+    }
+
+    if (0 != uart_gap_handler)
+    {
+        // one-pulse mode stops the counter on the update
+        TIM4_SetCounter(0);
+        TIM4_Cmd(ENABLE);
+    }
+}
+
+INTERRUPT_HANDLER(TIM4_UPD_OVF_IRQHandler, 23)
+{
+    TIM4_ClearITPendingBit(TIM4_IT_UPDATE);
+
+    if (0 != uart_gap_handler)
+    {
+        uart_gap_handler();
+    }
+}
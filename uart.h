@@ -0,0 +1,41 @@
+/************************************************************************************************
+ * UART:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// UART1 transmitter fed from a ring buffer by the TXE interrupt. Writers never wait. Received
+// bytes are passed to the receiver right from the RX interrupt.
+// UART1 TX/RX are PD5/PD6, shared with the MODE and POWER LEDs (see USE_UART1 in main.c).
+// The baud rate and the gap timer follow clock changes, a byte on the line during one is lost.
+
+// Power of 2
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 64
+#endif
+
+// Called from the RX interrupt for every received byte
+typedef void (*UARTReceiver)(uint8_t data);
+
+// Called from the TIM4 interrupt when the line has been silent for the gap time after a byte
+typedef void (*UARTGapHandler)();
+
+void initUART(uint32_t baudrate);
+
+// Enables receiving, 0 disables it
+void setUARTReceiver(UARTReceiver receiver);
+
+// Starts TIM4 as a one-pulse gap timer restarted by every received byte. Gap is up to 2 ms.
+// 0 disables it
+void setUARTGapHandler(UARTGapHandler handler, uint16_t gap_us);
+
+// Copies all bytes to the buffer or nothing if there is not enough room
+bool writeUART(const uint8_t *data, uint8_t size);
+
+uint8_t getUARTFreeSpace();
+
+// Nothing to send, the last byte is out, and nothing has been received for quiet_ms
+bool isUARTQuiet(uint16_t quiet_ms);
@@ -6,8 +6,17 @@
 
 #include <stm8s.h>
 
+// Block which runs with interrupts disabled and restores the previous interrupt state after,
+// so it can be used in interrupt handlers too.
+#ifdef __SDCC
+#define CRITICAL __critical
+#else
+#define CRITICAL
+#endif
+
 void delayMs(uint16_t ms);
 
-void fatal(uint8_t err);
+// Milliseconds since boot
+uint32_t getMillis();
 
 void writePin(GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef PortPin, bool val);
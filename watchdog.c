@@ -0,0 +1,140 @@
+/************************************************************************************************
+ * Watchdog:
+ ************************************************************************************************/
+
+#include <watchdog.h>
+#include <journal.h>
+#include <utilities.h>
+
+#include <stm8s_iwdg.h>
+#include <stm8s_rst.h>
+
+#include <string.h>
+
+#define RESETS_VERSION 1
+
+// Counted causes, RESET_POWER_ON is not stored. Fits JOURNAL_PAYLOAD_SIZE
+typedef struct
+{
+    uint16_t counts[RESET_CAUSES_COUNT - 1];
+} SResetCounts;
+
+typedef struct
+{
+    RST_Flag_TypeDef flag;
+    EResetCause      cause;
+} SResetFlag;
+
+const SResetFlag reset_flags[] =
+{
+    {RST_FLAG_IWDGF,  RESET_WATCHDOG},
+    {RST_FLAG_WWDGF,  RESET_WINDOW_WATCHDOG},
+    {RST_FLAG_ILLOPF, RESET_ILLEGAL_OPCODE},
+    {RST_FLAG_EMCF,   RESET_EMC},
+    {RST_FLAG_SWIMF,  RESET_SWIM},
+};
+
+EResetCause      reset_cause        = RESET_POWER_ON;
+SResetCounts     reset_counts;
+
+volatile uint8_t watchdog_alive     = 0; // tasks checked in during the current window
+bool             watchdog_healthy   = true;
+uint16_t         watchdog_window_ms = 0;
+
+// private:
+void readResetCause()
+{
+    for (uint8_t i = 0; i < sizeof(reset_flags)/sizeof(SResetFlag); i++)
+    {
+        if (SET == RST_GetFlagStatus(reset_flags[i].flag))
+        {
+            // the first one wins if several are set
+            if (RESET_POWER_ON == reset_cause)
+            {
+                reset_cause = reset_flags[i].cause;
+            }
+
+            RST_ClearFlag(reset_flags[i].flag);
+        }
+    }
+}
+
+// private:
+void countReset()
+{
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE] = {0};
+    uint8_t version;
+
+    memset(&reset_counts, 0, sizeof(reset_counts));
+
+    if (readJournal(JOURNAL_RESETS, &version, payload) && (RESETS_VERSION == version))
+    {
+        memcpy(&reset_counts, payload, sizeof(reset_counts));
+    }
+
+    if (RESET_POWER_ON == reset_cause)
+    {
+        return;
+    }
+
+    if (0xFFFF != reset_counts.counts[reset_cause - 1])
+    {
+        reset_counts.counts[reset_cause - 1]++;
+    }
+
+    memcpy(payload, &reset_counts, sizeof(reset_counts));
+    writeJournal(JOURNAL_RESETS, RESETS_VERSION, payload, 0);
+}
+
+// public:
+void initWatchdog()
+{
+    readResetCause();
+    countReset();
+
+    // LSI 128 kHz / 2 / 256 / 255, ~1.02 s
+    IWDG_Enable();
+    IWDG_WriteAccessCmd(IWDG_WriteAccess_Enable);
+    IWDG_SetPrescaler(IWDG_Prescaler_256);
+    IWDG_SetReload(0xFF);
+    IWDG_ReloadCounter();
+}
+
+// public:
+EResetCause getResetCause()
+{
+    return reset_cause;
+}
+
+// public:
+uint16_t getResetCount(EResetCause cause)
+{
+    return (RESET_POWER_ON == cause) ? 0 : reset_counts.counts[cause - 1];
+}
+
+// public:
+void checkInWatchdog(uint8_t tasks)
+{
+    CRITICAL
+    {
+        watchdog_alive |= tasks;
+    }
+}
+
+// public:
+void handleWatchdogTick()
+{
+    watchdog_window_ms++;
+
+    if (WATCHDOG_WINDOW_MS <= watchdog_window_ms)
+    {
+        watchdog_window_ms = 0;
+        watchdog_healthy   = watchdog_healthy && (WATCHDOG_TASKS_ALL == watchdog_alive);
+        watchdog_alive     = 0;
+    }
+
+    if (watchdog_healthy)
+    {
+        IWDG_ReloadCounter();
+    }
+}
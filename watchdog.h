@@ -0,0 +1,51 @@
+/************************************************************************************************
+ * Watchdog:
+ ************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// IWDG with ~1 s timeout, refreshed from the 1 ms tick while the periodic tasks are alive. Each
+// task checks in at least once per WATCHDOG_WINDOW_MS. At the end of a window where any task has
+// not checked in the refresh stops for good and the MCU resets. A hang with interrupts disabled
+// stops the tick and resets the MCU too. Port pins are inputs after reset, so heater and fan are off.
+
+#define WATCHDOG_WINDOW_MS 2000
+
+typedef enum
+{
+    WATCHDOG_TASK_SENSOR  = 0x01,
+    WATCHDOG_TASK_CONTROL = 0x02,
+    WATCHDOG_TASK_DISPLAY = 0x04,
+    WATCHDOG_TASK_KEYS    = 0x08,
+
+    WATCHDOG_TASKS_ALL    = 0x0F
+} EWatchdogTask;
+
+typedef enum
+{
+    RESET_POWER_ON,         // or NRST pin, no flag is set for them
+    RESET_WATCHDOG,
+    RESET_WINDOW_WATCHDOG,
+    RESET_ILLEGAL_OPCODE,
+    RESET_EMC,
+    RESET_SWIM,
+    RESET_CAUSES_COUNT
+} EResetCause;
+
+// Takes and clears the reset flags, counts the cause in the journal and starts the IWDG.
+// Must be called after initJournal()
+void initWatchdog();
+
+EResetCause getResetCause();
+
+// Lifetime number of resets of cause, 0 for RESET_POWER_ON
+uint16_t getResetCount(EResetCause cause);
+
+// tasks is a mask of EWatchdogTask
+void checkInWatchdog(uint8_t tasks);
+
+// Called from the 1 ms tick interrupt
+void handleWatchdogTick();